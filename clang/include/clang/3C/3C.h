@@ -20,8 +20,13 @@
 #include "clang/3C/PersistentSourceLoc.h"
 #include "clang/3C/ProgramInfo.h"
 #include "clang/Tooling/CommonOptionsParser.h"
+#include "llvm/ADT/StringSet.h"
+#include <deque>
+#include <map>
 #include <mutex>
 
+struct RewrittenFile;
+
 // The main interface exposed by the 3C to interact with the tool.
 //
 // See clang/docs/checkedc/3C/clang-tidy.md#_3c-name-prefix
@@ -52,6 +57,13 @@ public:
   // Call clang to provide the data
   bool parseASTs();
 
+  // Like parseASTs, but take over the ASTs of Previous, which must have been
+  // created with the same source files, and re-parse only the translation
+  // units that read one of ChangedFiles (canonical paths) or that Previous
+  // failed to parse. Used by the 3C server (-server).
+  bool parseASTs(_3CInterface &Previous,
+                 const std::set<std::string> &ChangedFiles);
+
   // Constraints
 
   // Create ConstraintVariables to hold constraints
@@ -83,6 +95,11 @@ public:
   // to disk
   bool writeAllConvertedFilesToDisk();
 
+  // Rewrite the input files as writeAllConvertedFilesToDisk does, but return
+  // the new versions of the changed files, keyed by output path, instead of
+  // writing them.
+  bool getAllConvertedFiles(std::map<std::string, RewrittenFile> &Files);
+
   // Dump all stats related to performance.
   bool dumpStats();
 
@@ -106,12 +123,70 @@ private:
   // verification.
   bool isSuccessfulSoFar();
 
-  // saved ASTs
+  // saved ASTs. With -max-resident-asts, the entries of translation units
+  // that are not currently resident are null.
   std::vector<std::unique_ptr<ASTUnit>> ASTs;
 
+  // What we need to re-parse a translation unit after its AST has been
+  // evicted in bounded-memory mode (-max-resident-asts), along with the
+  // diagnostic status of the evicted instances of the translation unit.
+  struct TranslationUnitState {
+    std::shared_ptr<CompilerInvocation> Invocation;
+    IntrusiveRefCntPtr<FileManager> Files;
+    std::shared_ptr<PCHContainerOperations> PCHContainerOps;
+    unsigned NumErrors = 0;
+    bool FinishedWithoutErrors = true;
+  };
+  std::vector<TranslationUnitState> TUStates;
+  // Indices of the resident translation units, least recently loaded first.
+  std::deque<unsigned> ResidentTUs;
+
+  // The files a translation unit read, recorded when it is first parsed. They
+  // tell when a rewritten file can be written and, in server mode, which
+  // translation units an edited file affects.
+  struct TranslationUnitFiles {
+    std::string MainFile;
+    // The files the translation unit read, named as in PersistentSourceLocs.
+    llvm::StringSet<> Files;
+  };
+  std::vector<TranslationUnitFiles> TUFiles;
+  static TranslationUnitFiles getTUFiles(ASTUnit &AST);
+
+  friend class _3CASTBuilderAction;
+  // Parse the translation units of the given source files with ClangTool.
+  void runClangTool(const std::vector<std::string> &Files);
+  void addParsedAST(std::unique_ptr<ASTUnit> AST,
+                    std::shared_ptr<CompilerInvocation> Invocation,
+                    FileManager *Files,
+                    std::shared_ptr<PCHContainerOperations> PCHContainerOps);
+  // Evict the least recently loaded ASTs until at most Keep remain resident.
+  void evictASTs(unsigned Keep);
+  // Re-parse the translation unit with the given index. Returns false if
+  // parsing failed.
+  bool reloadAST(unsigned Idx);
+  // Call Fn on the ASTContext of each translation unit, in order. In
+  // bounded-memory mode, translation units are re-parsed as needed. Returns
+  // false, after reporting an error, if one cannot be re-parsed; Fn has then
+  // not been called on it or on the ones after it.
+  LLVM_NODISCARD bool
+  forEachTranslationUnit(llvm::function_ref<void(ASTContext &)> Fn);
+  // Whether per-translation-unit work may be spread over threads (-num-threads).
+  bool useParallelTranslationUnits();
+  // Call Fn on the index and ASTContext of each translation unit using a pool
+  // of -num-threads threads. Fn must not modify any state shared between
+  // translation units. Only valid when useParallelTranslationUnits() is true.
+  void forEachTranslationUnitInParallel(
+      llvm::function_ref<void(unsigned, ASTContext &)> Fn);
+
   // Are constraints already built?
   bool ConstraintsBuilt;
-  void invalidateAllConstraintsWithReason(Constraint *ConstraintToRemove);
+  void invalidateAllConstraintsWithReason(
+      Constraint *ConstraintToRemove,
+      Constraints::ConstraintSet &ToRemoveConstraints);
+  // Update the solution and the interim constraint state after the given
+  // constraints were removed. This is done incrementally when the constraint
+  // system allows it, and by solving from scratch otherwise.
+  void resolveAfterRemoval(const Constraints::ConstraintSet &Removed);
 };
 
 #endif // LLVM_CLANG_3C_3C_H
@@ -69,6 +69,29 @@ struct _3COptions {
   bool ItypesForExtern;
 
   bool InferTypesForUndefs;
+
+  // Maximum number of ASTs kept in memory at once; 0 means no limit.
+  unsigned MaxResidentASTs;
+
+  // Maximum number of contexts for context-sensitive bounds keys of a single
+  // callee or struct; 0 means no limit.
+  unsigned MaxCtxPerCallee;
+
+  // Number of threads for the per-translation-unit phases that support
+  // parallelism; 0 means one per hardware thread.
+  unsigned NumThreads;
+
+  // File to which a Chrome trace of the phases of 3C is written, in the
+  // format of clang's -ftime-trace; empty means no trace.
+  std::string TimeTraceFile;
+
+  // Write the -dump-intermediate constraint output as newline-delimited JSON
+  // instead of a single JSON document.
+  bool ConstraintOutputNDJson;
+
+  // Run as a server that answers JSON-RPC requests on stdin and stdout
+  // (-server).
+  bool Server;
 };
 
 // NOLINTNEXTLINE(readability-identifier-naming)
@@ -82,6 +82,9 @@ private:
 
   std::map<ConstraintVariable *, CVars> PtrRCMap;
   std::map<ConstraintKey, std::set<ConstraintVariable *>> PtrSrcWMap;
+  // The constraint variable containing each atom, used to keep the two maps
+  // above up to date when root causes are removed.
+  std::map<ConstraintKey, ConstraintVariable *> AtomPtrMap;
 
   // Get score for each of the ConstraintKeys, which are wild.
   // For the above example, the score of s would be 0.5, similarly
@@ -90,7 +93,7 @@ private:
 
   float getPtrAffectedScore(const std::set<ConstraintVariable *> CVs);
 
-  void printConstraintStats(raw_ostream &O, Constraints &CS,
+  void printConstraintStats(llvm::json::OStream &J, Constraints &CS,
                             ConstraintKey Cause);
 };
 
@@ -0,0 +1,33 @@
+//=--3CServer.h---------------------------------------------------*- C++-*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// A long-running 3C that keeps the ASTs of a program in memory and converts
+// the program again after each edit, answering JSON-RPC requests from an
+// editor or IDE.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_3C_3CSERVER_H
+#define LLVM_CLANG_3C_3CSERVER_H
+
+#include "clang/Tooling/CompilationDatabase.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cstdio>
+
+struct _3COptions;
+
+// Read JSON-RPC 2.0 requests from In, one per line, and write a response line
+// to Out for each request that has an id, until a "shutdown" request or the
+// end of the input. The methods are described in clang/tools/3c/README.md.
+// Returns the exit code that the `3c` tool should exit with.
+int run3CServer(const struct _3COptions &CCopt,
+                const std::vector<std::string> &SourceFileList,
+                clang::tooling::CompilationDatabase *CompDB, std::FILE *In,
+                llvm::raw_ostream &Out);
+
+#endif // LLVM_CLANG_3C_3CSERVER_H
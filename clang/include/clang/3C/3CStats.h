@@ -15,16 +15,60 @@
 #include "clang/AST/Decl.h"
 #include "clang/AST/RecursiveASTVisitor.h"
 #include "clang/AST/Stmt.h"
+#include "llvm/Support/JSON.h"
 #include "llvm/Support/raw_ostream.h"
+#include <chrono>
+#include <map>
+
+// Resources used by one phase of 3C, summed over every interval in which the
+// phase ran.
+struct PhaseStats {
+  // Elapsed time on a monotonic clock, in seconds.
+  double WallTime = 0;
+  // User plus system time of the whole process, in seconds. This can exceed
+  // WallTime when work runs on several threads.
+  double CPUTime = 0;
+  // Bytes allocated by malloc minus bytes freed while the phase ran.
+  int64_t MallocBytes = 0;
+  // Peak resident set size of the process, in bytes, when the phase last
+  // ended, or 0 if the platform does not report it.
+  uint64_t PeakRSS = 0;
+  unsigned long Intervals = 0;
+};
+
+// Wall-clock stopwatch on a monotonic clock, for timing work that is only part
+// of a phase, such as one translation unit.
+class WallClockTimer {
+public:
+  WallClockTimer() : Start(std::chrono::steady_clock::now()) {}
+  double seconds() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         Start)
+        .count();
+  }
+
+private:
+  std::chrono::steady_clock::time_point Start;
+};
 
 class PerformanceStats {
 public:
-  double CompileTime;
-  double ConstraintBuilderTime;
-  double ConstraintSolverTime;
-  double ArrayBoundsInferenceTime;
-  double RewritingTime;
-  double TotalTime;
+  PhaseStats Compile;
+  PhaseStats VariableAdder;
+  PhaseStats ConstraintBuilder;
+  PhaseStats ConstraintSolver;
+  PhaseStats ArrayBoundsInference;
+  PhaseStats Rewriting;
+  PhaseStats Total;
+
+  // Wall-clock time of the AST visitors on a single translation unit.
+  struct TUTimes {
+    double VariableAdderTime = 0;
+    double ConstraintBuilderTime = 0;
+    double RewritingTime = 0;
+  };
+  // Keyed by main file name.
+  std::map<std::string, TUTimes> PerTUTimes;
 
   // Rewrite Stats
   unsigned long NumAssumeBoundsCasts;
@@ -35,24 +79,45 @@ public:
   unsigned long NumCheckedRegions;
   unsigned long NumUnCheckedRegions;
 
-  PerformanceStats() {
-    CompileTime = ConstraintBuilderTime = 0;
-    ConstraintSolverTime = ArrayBoundsInferenceTime = 0;
-    RewritingTime = TotalTime = 0;
+  // Reachability cache stats (see DataGraph::visitBreadthFirst)
+  unsigned long ReachabilityCacheNodes;
+  unsigned long ReachabilityCacheEvictions;
 
-    CompileTimeSt = ConstraintBuilderTimeSt = 0;
-    ConstraintSolverTimeSt = ArrayBoundsInferenceTimeSt = 0;
-    RewritingTimeSt = TotalTimeSt = 0;
+  // Array bounds inference stats (see AVarBoundsInfo::performFlowAnalysis).
+  // A round runs the worklist inference once over each bounds graph.
+  unsigned long ArrayBoundsRuns;
+  unsigned long ArrayBoundsRounds;
+  unsigned long ArrayBoundsRoundsSkipped;
+  unsigned long ArrayBoundsKeysVisited;
+  unsigned long ArrayBoundsKeysInferred;
 
+  // Context-sensitive bounds key stats (see CtxSensitiveBoundsKeyHandler).
+  unsigned long CtxSensContexts;
+  unsigned long CtxSensContextsMerged;
+  unsigned long CtxSensContextsCapped;
+  unsigned long CtxSensKeys;
+
+  PerformanceStats() {
     NumAssumeBoundsCasts = NumCheckedCasts = 0;
     NumWildCasts = NumITypes = NumFixedCasts = 0;
 
     NumCheckedRegions = NumUnCheckedRegions = 0;
+
+    ReachabilityCacheNodes = ReachabilityCacheEvictions = 0;
+
+    ArrayBoundsRuns = ArrayBoundsRounds = ArrayBoundsRoundsSkipped = 0;
+    ArrayBoundsKeysVisited = ArrayBoundsKeysInferred = 0;
+
+    CtxSensContexts = CtxSensContextsMerged = CtxSensContextsCapped = 0;
+    CtxSensKeys = 0;
   }
 
   void startCompileTime();
   void endCompileTime();
 
+  void startVariableAdderTime();
+  void endVariableAdderTime();
+
   void startConstraintBuilderTime();
   void endConstraintBuilderTime();
 
@@ -68,6 +133,10 @@ public:
   void startTotalTime();
   void endTotalTime();
 
+  TUTimes &getTUTimes(clang::ASTContext &C);
+  // The main file name of the translation unit, for per-TU stats and traces.
+  static std::string getTUName(clang::ASTContext &C);
+
   void incrementNumAssumeBounds();
   void incrementNumCheckedCasts();
   void incrementNumWildCasts();
@@ -77,14 +146,28 @@ public:
   void incrementNumUnCheckedRegions();
 
   void printPerformanceStats(llvm::raw_ostream &O, bool JsonFormat);
+  void printPerformanceStats(llvm::json::OStream &J);
 
 private:
-  clock_t CompileTimeSt;
-  clock_t ConstraintBuilderTimeSt;
-  clock_t ConstraintSolverTimeSt;
-  clock_t ArrayBoundsInferenceTimeSt;
-  clock_t RewritingTimeSt;
-  clock_t TotalTimeSt;
+  struct PhaseStart {
+    std::chrono::steady_clock::time_point WallTime;
+    double CPUTime = 0;
+    size_t MallocBytes = 0;
+  };
+
+  // The phases, in the order in which they are printed.
+  std::vector<std::pair<const char *, const PhaseStats *>> getPhases() const;
+
+  static void startPhase(PhaseStart &St);
+  static void endPhase(PhaseStats &Stats, const PhaseStart &St);
+
+  PhaseStart CompileTimeSt;
+  PhaseStart VariableAdderTimeSt;
+  PhaseStart ConstraintBuilderTimeSt;
+  PhaseStart ConstraintSolverTimeSt;
+  PhaseStart ArrayBoundsInferenceTimeSt;
+  PhaseStart RewritingTimeSt;
+  PhaseStart TotalTimeSt;
 };
 
 class ProgramInfo;
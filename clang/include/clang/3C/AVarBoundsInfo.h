@@ -20,9 +20,73 @@
 #include "clang/3C/PersistentSourceLoc.h"
 #include "clang/3C/ProgramVar.h"
 #include "clang/AST/Decl.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/Support/JSON.h"
 
 class ProgramInfo;
 class ConstraintResolver;
+class PerformanceStats;
+
+// A set of BoundsKeys stored as a bit vector indexed by the key. BoundsKeys
+// are handed out sequentially from AVarBoundsInfo::BCount, so this is dense
+// and membership tests are a single bit test. Iteration visits keys in
+// ascending order, the same order as a std::set<BoundsKey>.
+class BoundsKeySet {
+public:
+  class iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = BoundsKey;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const BoundsKey *;
+    using reference = BoundsKey;
+
+    iterator(const llvm::BitVector &Bits, int Current)
+        : Bits(&Bits), Current(Current) {}
+    BoundsKey operator*() const { return Current; }
+    iterator &operator++() {
+      Current = Bits->find_next(Current);
+      return *this;
+    }
+    iterator operator++(int) {
+      iterator Prev = *this;
+      ++*this;
+      return Prev;
+    }
+    bool operator==(const iterator &O) const { return Current == O.Current; }
+    bool operator!=(const iterator &O) const { return Current != O.Current; }
+
+  private:
+    const llvm::BitVector *Bits;
+    int Current;
+  };
+
+  // Returns true if BK was not already in the set.
+  bool insert(BoundsKey BK) {
+    if (BK >= Bits.size())
+      Bits.resize(std::max<size_t>(BK + 1, Bits.size() * 2));
+    if (Bits.test(BK))
+      return false;
+    Bits.set(BK);
+    return true;
+  }
+  bool erase(BoundsKey BK) {
+    if (!count(BK))
+      return false;
+    Bits.reset(BK);
+    return true;
+  }
+  bool count(BoundsKey BK) const { return BK < Bits.size() && Bits.test(BK); }
+  bool empty() const { return Bits.none(); }
+  size_t size() const { return Bits.count(); }
+  void clear() { Bits.clear(); }
+
+  iterator begin() const { return iterator(Bits, Bits.find_first()); }
+  iterator end() const { return iterator(Bits, -1); }
+
+private:
+  llvm::BitVector Bits;
+};
 
 // Class that maintains stats about how the bounds of various variables is
 // computed.
@@ -62,8 +126,11 @@ public:
   bool isNeighbourParamMatch(BoundsKey BK) {
     return NeighbourParamMatch.find(BK) != NeighbourParamMatch.end();
   }
-  void print(llvm::raw_ostream &O, const std::set<BoundsKey> *InSrcArrs,
-             bool JsonFormat = false) const;
+  void print(llvm::raw_ostream &O, const std::set<BoundsKey> *InSrcArrs) const;
+  // Write the stats as the ArrayBoundsInferenceStats attribute of the current
+  // JSON object.
+  void print(llvm::json::OStream &J,
+             const std::set<BoundsKey> *InSrcArrs) const;
   void dump(const std::set<BoundsKey> *InSrcArrs) const {
     print(llvm::errs(), InSrcArrs);
   }
@@ -111,6 +178,11 @@ public:
   // Get a consistent bound for all the arrays whose bounds have been inferred.
   void convergeInferredBounds();
 
+  // Take the inferred bounds of every key not in Keep from Saved, keeping the
+  // current inferred bounds of the keys in Keep.
+  void reuseInferredBounds(const AvarBoundsInference &Saved,
+                           const BoundsKeySet &Keep);
+
 private:
   // Find all the reachable variables form FromVarK that are visible
   // in DstScope
@@ -170,11 +242,12 @@ public:
   void addPotentialBoundsPOne(BoundsKey BK, const std::set<BoundsKey> &PotK);
 
 private:
-  // This is the map of pointer variable bounds key and set of bounds key
-  // which can be the count bounds.
-  std::map<BoundsKey, std::set<BoundsKey>> PotentialCntBounds;
+  // This is indexed by pointer variable bounds key and holds the set of bounds
+  // key which can be the count bounds. An empty set means no potential
+  // bounds.
+  std::vector<std::set<BoundsKey>> PotentialCntBounds;
   // Potential count + 1 bounds.
-  std::map<BoundsKey, std::set<BoundsKey>> PotentialCntPOneBounds;
+  std::vector<std::set<BoundsKey>> PotentialCntPOneBounds;
 };
 
 class AVarBoundsInfo {
@@ -183,12 +256,6 @@ public:
       : ProgVarGraph(this), CtxSensProgVarGraph(this),
         RevCtxSensProgVarGraph(this), CSBKeyHandler(this) {
     BCount = 1;
-    PVarInfo.clear();
-    InProgramArrPtrBoundsKeys.clear();
-    BInfo.clear();
-    DeclVarMap.clear();
-    TmpBoundsKey.clear();
-    ArrPointersWithArithmetic.clear();
   }
 
   typedef std::tuple<std::string, std::string, bool, unsigned> ParamDeclType;
@@ -277,14 +344,20 @@ public:
     return CSBKeyHandler;
   }
 
+  ProgramVarScopeTable &getScopes() { return Scopes; }
+
   AVarBoundsStats &getBStats() { return BoundsInferStats; }
 
   // Dump the AVar graph to the provided dot file.
   void dumpAVarGraph(const std::string &DFPath);
 
   // Print the stats about computed bounds information.
-  void printStats(llvm::raw_ostream &O, const CVarSet &SrcCVarSet,
-                  bool JsonFormat = false) const;
+  void printStats(llvm::raw_ostream &O, const CVarSet &SrcCVarSet) const;
+  void printStats(llvm::json::OStream &J, const CVarSet &SrcCVarSet) const;
+
+  // Add the sizes of the reachability caches of the bounds graphs to Nodes and
+  // Evictions.
+  void addReachabilityCacheStats(size_t &Nodes, size_t &Evictions) const;
 
   bool areSameProgramVar(BoundsKey B1, BoundsKey B2);
 
@@ -304,36 +377,50 @@ private:
 
   // Variable that is used to generate new bound keys.
   BoundsKey BCount;
-  // Map of VarKeys and corresponding program variables.
-  std::map<BoundsKey, ProgramVar *> PVarInfo;
+  // Scopes of the program variables.
+  ProgramVarScopeTable Scopes;
+  // Program variables indexed by VarKey, nullptr for keys without one.
+  std::vector<ProgramVar *> PVarInfo;
   // Map of APSInt (constants) and a BoundKey that correspond to it.
-  std::map<uint64_t, BoundsKey> ConstVarKeys;
-  // Map of BoundsKey and corresponding prioritized bounds information.
+  std::unordered_map<uint64_t, BoundsKey> ConstVarKeys;
+  // Prioritized bounds information indexed by BoundsKey. An empty map means
+  // the key has no bounds.
   // Note that although each PSL could have multiple ConstraintKeys Ex: **p.
   // Only the outer most pointer can have bounds.
-  std::map<BoundsKey, std::map<BoundsPriority, ABounds *>> BInfo;
+  std::vector<std::map<BoundsPriority, ABounds *>> BInfo;
   // Set that contains BoundsKeys of variables which have invalid bounds.
-  std::set<BoundsKey> InvalidBounds;
+  BoundsKeySet InvalidBounds;
   // These are the bounds key of the pointers that has arithmetic operations
   // performed on them.
-  std::set<BoundsKey> ArrPointersWithArithmetic;
+  BoundsKeySet ArrPointersWithArithmetic;
   // Set of BoundsKeys that correspond to pointers.
-  std::set<BoundsKey> PointerBoundsKey;
+  BoundsKeySet PointerBoundsKey;
   // Set of BoundsKey that correspond to array pointers.
-  std::set<BoundsKey> ArrPointerBoundsKey;
-  std::set<BoundsKey> NtArrPointerBoundsKey;
+  BoundsKeySet ArrPointerBoundsKey;
+  BoundsKeySet NtArrPointerBoundsKey;
   // These are array and nt arr pointers which cannot have bounds.
   // E.g., return value of strdup and in general any return value
   // which is an nt array.
-  std::set<BoundsKey> PointersWithImpossibleBounds;
+  BoundsKeySet PointersWithImpossibleBounds;
   // Set of BoundsKey that correspond to array pointers with in the program
   // being compiled i.e., it does not include array pointers that belong
   // to libraries.
-  std::set<BoundsKey> InProgramArrPtrBoundsKeys;
+  BoundsKeySet InProgramArrPtrBoundsKeys;
 
   // These are temporary bound keys generated during inference.
   // They do not correspond to any bounds variable.
-  std::set<BoundsKey> TmpBoundsKey;
+  BoundsKeySet TmpBoundsKey;
+
+  // Return true if L has bounds of some priority.
+  bool hasBoundsInfo(BoundsKey L) const {
+    return L < BInfo.size() && !BInfo[L].empty();
+  }
+  // Get the prioritized bounds of L, growing BInfo if needed.
+  std::map<BoundsPriority, ABounds *> &getBoundsInfo(BoundsKey L) {
+    if (L >= BInfo.size())
+      BInfo.resize(std::max<size_t>(L + 1, BInfo.size() * 2));
+    return BInfo[L];
+  }
 
   // BiMap of Persistent source loc and BoundsKey of regular variables.
   BiMap<PersistentSourceLoc, BoundsKey> DeclVarMap;
@@ -382,9 +469,31 @@ private:
   bool keepHighestPriorityBounds();
 
   // Perform worklist based inference on the requested array variables using
-  // the provided graph and potential length variables.
+  // the provided graph and potential length variables. If Seed is given, only
+  // the array variables in it start on the worklist.
   void performWorkListInference(const AVarGraph &BKGraph,
-                                AvarBoundsInference &BI, bool FromPB);
+                                AvarBoundsInference &BI, bool FromPB,
+                                const BoundsKeySet *Seed,
+                                PerformanceStats &PStats);
+
+  // Keys whose bounds, invalid bounds or impossible bounds changed since the
+  // last round of performFlowAnalysis without (index 0) or with (index 1)
+  // potential bounds began. Inference reads nothing else that changes during
+  // performFlowAnalysis.
+  BoundsKeySet ChangedKeys[2];
+  void markBoundsChanged(BoundsKey BK) {
+    ChangedKeys[0].insert(BK);
+    ChangedKeys[1].insert(BK);
+  }
+  // Find the array pointer keys of the variables in SrcCVarSet, and the
+  // null-terminated array pointers that do not need bounds, for printStats.
+  void getStatsKeys(const CVarSet &SrcCVarSet,
+                    std::set<BoundsKey> &InSrcArrBKeys,
+                    std::set<BoundsKey> &NTArrayReqNoBounds) const;
+
+  // Add the given keys and all keys reachable from them in any of the
+  // bounds graphs to Affected.
+  void getAffectedKeys(const BoundsKeySet &Keys, BoundsKeySet &Affected) const;
 
   void insertParamKey(ParamDeclType ParamDecl, BoundsKey NK);
 
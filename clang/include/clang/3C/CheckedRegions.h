@@ -18,6 +18,8 @@
 #include "clang/AST/Decl.h"
 #include "clang/AST/Stmt.h"
 #include "clang/Rewrite/Core/Rewriter.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
 #include <utility>
 
 typedef enum {
@@ -31,21 +33,25 @@ class CheckedRegionAdder
 public:
   explicit CheckedRegionAdder(
       clang::ASTContext *C, clang::Rewriter &R,
-      std::map<llvm::FoldingSetNodeID, AnnotationNeeded> &M, ProgramInfo &I)
+      llvm::DenseMap<const clang::Stmt *, AnnotationNeeded> &M,
+      ProgramInfo &I)
       : Context(C), Writer(R), Map(M), Info(I) {}
 
+  bool TraverseCompoundStmt(clang::CompoundStmt *S);
   bool VisitCompoundStmt(clang::CompoundStmt *S);
   bool VisitCallExpr(clang::CallExpr *C);
 
 private:
-  std::pair<const clang::CompoundStmt *, int>
-  findParentCompound(const clang::DynTypedNode &N, int);
-  bool isParentChecked(const clang::DynTypedNode &N);
+  const clang::CompoundStmt *getEnclosingCompound(const clang::Stmt *S);
+  bool isParentChecked(const clang::Stmt *S);
   bool isWrittenChecked(const clang::CompoundStmt *);
   clang::ASTContext *Context;
   clang::Rewriter &Writer;
-  std::map<llvm::FoldingSetNodeID, AnnotationNeeded> &Map;
+  llvm::DenseMap<const clang::Stmt *, AnnotationNeeded> &Map;
   ProgramInfo &Info;
+  // The compound statements enclosing the current point of the traversal,
+  // innermost last.
+  std::vector<const clang::CompoundStmt *> EnclosingCompounds;
 };
 
 class CheckedRegionFinder
@@ -53,8 +59,9 @@ class CheckedRegionFinder
 public:
   explicit CheckedRegionFinder(
       clang::ASTContext *C, clang::Rewriter &R, ProgramInfo &I,
-      std::set<llvm::FoldingSetNodeID> &S,
-      std::map<llvm::FoldingSetNodeID, AnnotationNeeded> &M, bool EmitWarnings)
+      llvm::DenseSet<const clang::Stmt *> &S,
+      llvm::DenseMap<const clang::Stmt *, AnnotationNeeded> &M,
+      bool EmitWarnings)
       : Context(C), Writer(R), Info(I), Seen(S), Map(M),
         EmitWarnings(EmitWarnings) {}
   bool Wild = false;
@@ -87,8 +94,8 @@ private:
   clang::ASTContext *Context;
   clang::Rewriter &Writer;
   ProgramInfo &Info;
-  std::set<llvm::FoldingSetNodeID> &Seen;
-  std::map<llvm::FoldingSetNodeID, AnnotationNeeded> &Map;
+  llvm::DenseSet<const clang::Stmt *> &Seen;
+  llvm::DenseMap<const clang::Stmt *, AnnotationNeeded> &Map;
   std::set<PersistentSourceLoc> Emitted;
   bool EmitWarnings;
 };
@@ -29,6 +29,54 @@ private:
   ProgramInfo &Info;
 };
 
+// Collects the variables of a single translation unit without modifying
+// ProgramInfo, so that the ASTs of several translation units can be traversed
+// in parallel. The collected declarations are later added to ProgramInfo by
+// mergeInto, which must be called for each translation unit in order. Creating
+// the constraint variables happens during the merge because it allocates atoms
+// from the shared constraint system, whose numbering must stay deterministic.
+// The work that only reads the AST is done by the shard instead: it computes
+// the PersistentSourceLoc of each variable and prints the types that the
+// constraint variables will need (see ProgramInfo::getTypeString).
+class VariableAdderShard : public ProgramVariableAdder {
+public:
+  void collect(clang::ASTContext &C);
+  void mergeInto(ProgramInfo &Info);
+
+  void addVariable(clang::DeclaratorDecl *D,
+                   clang::ASTContext *AstContext) override;
+  void addABoundsVariable(clang::Decl *D) override;
+  bool seenTypedef(PersistentSourceLoc PSL) override;
+  void addTypedef(PersistentSourceLoc PSL, bool CanRewriteDef,
+                  clang::TypedefDecl *TD, clang::ASTContext &C) override;
+
+protected:
+  AVarBoundsInfo &getABoundsInfo() override {
+    llvm_unreachable("VariableAdderShard records bounds variables instead.");
+  }
+
+private:
+  // Print the type strings of a pointer variable of type QT named Name, and
+  // those of each level of the type.
+  void addTypeStrings(clang::QualType QT, llvm::StringRef Name);
+
+  // The calls made by VariableAdderVisitor, in traversal order.
+  struct Entry {
+    enum EntryKind { EK_Variable, EK_ABoundsVariable, EK_Typedef };
+    EntryKind Kind;
+    clang::Decl *D;
+    PersistentSourceLoc PSL;
+    bool CanRewriteDef;
+  };
+  std::vector<Entry> Entries;
+  std::set<PersistentSourceLoc> SeenTypedefs;
+  TypeStringMap TypeStrings;
+  clang::ASTContext *Context = nullptr;
+  // Wall-clock time of collect, added to the translation unit's stats when
+  // the shard is merged.
+  double CollectTime = 0;
+};
+
 // Final step in generating initial constraints is to scan type variables and
 // function bodies for relationships that generate the constraints.
 class ConstraintBuilderConsumer : public clang::ASTConsumer {
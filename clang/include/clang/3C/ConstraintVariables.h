@@ -79,20 +79,22 @@ protected:
   // A string representation for the type of this variable. Note that for
   // complex types (e.g., function pointer, constant sized arrays), you cannot
   // concatenate the type string with an identifier and expect to obtain a valid
-  // variable declaration.
-  std::string OriginalType;
+  // variable declaration. This and the other strings describing the source
+  // declaration are interned (see internString) because the same type
+  // strings repeat across a large number of constraint variables.
+  llvm::StringRef OriginalType;
   // Underlying name of the C variable this ConstraintVariable represents. This
   // is not always a valid C identifier. It will be empty if no name was given
   // (e.g., some parameter declarations). It will be the predefined string
   // "$ret" when the ConstraintVariable represents a function return. It may
   // take other values if the ConstraintVariable does not represent a C
   // variable (e.g., explict casts and compound literals) .
-  std::string Name;
+  llvm::StringRef Name;
   // The combination of the type and name of the represented C variable. The
   // combination is handled by clang library routines, so complex types
   // like function pointers and constant size are handled correctly. See
   // comments on Name for when name should be a valid identifier.
-  std::string OriginalTypeWithName;
+  llvm::StringRef OriginalTypeWithName;
   // Set of constraint variables that have been constrained due to a
   // bounds-safe interface (itype). They are remembered as being constrained
   // so that later on we do not introduce a spurious constraint
@@ -109,15 +111,16 @@ protected:
   bool IsForDecl;
 
   // Only subclasses should call this
-  ConstraintVariable(ConstraintVariableKind K, std::string T, std::string N,
-                     std::string TN)
-    : Kind(K), OriginalType(T), Name(N), OriginalTypeWithName(TN),
+  ConstraintVariable(ConstraintVariableKind K, llvm::StringRef T,
+                     llvm::StringRef N, llvm::StringRef TN)
+    : Kind(K), OriginalType(internString(T)), Name(internString(N)),
+      OriginalTypeWithName(internString(TN)),
       HasEqArgumentConstraints(false), ValidBoundsKey(false),
       IsForDecl(false) {}
 
-  ConstraintVariable(ConstraintVariableKind K, QualType QT, std::string N)
-    : ConstraintVariable(K, qtyToStr(QT), N,
-                         qtyToStr(QT, N == RETVAR ? "" : N)) {}
+  // The type strings are printed by ProgramInfo::getTypeString.
+  ConstraintVariable(ConstraintVariableKind K, QualType QT, std::string N,
+                     ProgramInfo &I);
 
 public:
   // Generate source code for the type and (in certain cases) the name of the
@@ -132,7 +135,7 @@ public:
   // Debug printing of the constraint variable.
   virtual void print(llvm::raw_ostream &O) const = 0;
   virtual void dump() const = 0;
-  virtual void dumpJson(llvm::raw_ostream &O) const = 0;
+  virtual void dumpJson(llvm::json::OStream &J) const = 0;
 
   virtual bool srcHasItype() const = 0;
   virtual bool srcHasBounds() const = 0;
@@ -190,12 +193,12 @@ public:
   virtual void mergeDeclaration(ConstraintVariable *, ProgramInfo &,
                                 std::string &ReasonFailed) = 0;
 
-  std::string getOriginalTy() const { return OriginalType; }
+  std::string getOriginalTy() const { return OriginalType.str(); }
   // Get the original type string that can be directly
   // used for rewriting.
   std::string getRewritableOriginalTy() const;
   std::string getOriginalTypeWithName() const;
-  std::string getName() const { return Name; }
+  std::string getName() const { return Name.str(); }
 
   void setValidDecl() { IsForDecl = true; }
   bool isForValidDecl() const { return IsForDecl; }
@@ -315,7 +318,7 @@ public:
   derefPVConstraint(PointerVariableConstraint *PVC);
 
 private:
-  std::string BaseType;
+  llvm::StringRef BaseType;
   CAtoms Vars;
   std::vector<ConstAtom *> SrcVars;
   FunctionVariableConstraint *FV;
@@ -330,14 +333,14 @@ private:
 
   // To help rewriting preserve macros and constant expressions in arrays size
   // expressions, the source strings for bounds of arrays are also stored.
-  std::map<uint32_t, std::string> ArrSizeStrs;
+  std::map<uint32_t, llvm::StringRef> ArrSizeStrs;
 
   // True if this variable has an itype in the original source code.
   bool SrcHasItype;
   // The string representation of the itype of in the original source. This
   // string is empty if the variable did not have an itype OR if the itype was
   // implicitly declared by a bounds declaration on an unchecked pointer.
-  std::string ItypeStr;
+  llvm::StringRef ItypeStr;
 
   // Get the qualifier string (e.g., const, etc) for the provided
   // pointer type into the provided string stream (ss).
@@ -383,7 +386,7 @@ private:
   PointerVariableConstraint(PointerVariableConstraint *Ot);
   PointerVariableConstraint *Parent;
   // String representing declared bounds expression.
-  std::string BoundsAnnotationStr;
+  llvm::StringRef BoundsAnnotationStr;
 
   // TODO can we move this to an optional instead of the -1?
   // Does this variable represent a generic type? Which one (or -1 for none)?
@@ -402,7 +405,7 @@ private:
 
   bool IsTypedef = false;
   ConstraintVariable *TypedefVar;
-  std::string TypedefString;
+  llvm::StringRef TypedefString;
   // Does the type internally contain a typedef, and if so: at what level and
   // what is it's name?
   struct InternalTypedefInfo TypedefLevelInfo;
@@ -421,7 +424,7 @@ private:
     TypedefLevelInfo({}), IsVoidPtr(false) {}
 
 public:
-  std::string getTy() const { return BaseType; }
+  std::string getTy() const { return BaseType.str(); }
   // Check if the outermost pointer is an unsized array.
   bool isTopAtomUnsizedArr() const;
   // Check if any of the pointers is either a sized or unsized arr.
@@ -437,11 +440,11 @@ public:
   // Return the string representation of the itype for this constraint if an
   // itype was present in the original source code. Returns empty string
   // otherwise.
-  std::string getItype() const { return ItypeStr; }
+  std::string getItype() const { return ItypeStr.str(); }
   // Check if this variable has bounds annotation.
   bool srcHasBounds() const override { return !BoundsAnnotationStr.empty(); }
   // Get bounds annotation.
-  std::string getBoundsStr() const { return BoundsAnnotationStr; }
+  std::string getBoundsStr() const { return BoundsAnnotationStr.str(); }
 
   bool isGeneric() const { return InferredGenericIndex >= 0; }
   int getGenericIndex() const { return InferredGenericIndex; }
@@ -528,7 +531,7 @@ public:
 
   void print(llvm::raw_ostream &O) const override;
   void dump() const override { print(llvm::errs()); }
-  void dumpJson(llvm::raw_ostream &O) const override;
+  void dumpJson(llvm::json::OStream &J) const override;
 
   void constrainToWild(Constraints &CS, const ReasonLoc &Rsn) const override;
   void constrainOuterTo(Constraints &CS, ConstAtom *C, const ReasonLoc &Rsn,
@@ -734,7 +737,7 @@ public:
                        const MkStringOpts &Opts = {}) const override;
   void print(llvm::raw_ostream &O) const override;
   void dump() const override { print(llvm::errs()); }
-  void dumpJson(llvm::raw_ostream &O) const override;
+  void dumpJson(llvm::json::OStream &J) const override;
 
   void constrainToWild(Constraints &CS, const ReasonLoc &Rsn) const override;
   bool anyChanges(const EnvironmentMap &E) const override;
@@ -18,6 +18,11 @@
 #define LLVM_CLANG_3C_CONSTRAINTS_H
 
 #include "clang/3C/Utils.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Allocator.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/JSON.h"
 #include "llvm/Support/raw_ostream.h"
@@ -66,7 +71,7 @@ public:
 
   virtual void print(llvm::raw_ostream &) const = 0;
   virtual void dump(void) const = 0;
-  virtual void dumpJson(llvm::raw_ostream &) const = 0;
+  virtual void dumpJson(llvm::json::OStream &) const = 0;
   std::string getStr() {
     std::string Buf;
     llvm::raw_string_ostream TmpS(Buf);
@@ -122,8 +127,11 @@ public:
 
   void dump(void) const override { print(llvm::errs()); }
 
-  void dumpJson(llvm::raw_ostream &O) const override {
-    O << "\"" << varKindToStr(KindV) << Name << "_" << Loc << "\"";
+  void dumpJson(llvm::json::OStream &J) const override {
+    llvm::SmallString<32> Str;
+    llvm::raw_svector_ostream OS(Str);
+    OS << varKindToStr(KindV) << Name << "_" << Loc;
+    J.value(OS.str());
   }
 
   bool operator==(const Atom &Other) const override {
@@ -147,7 +155,7 @@ public:
   VarKind getVarKind() const { return KindV; }
 
   // Returns the constraints associated with this atom.
-  std::set<Constraint *, PComp<Constraint *>> &getAllConstraints() {
+  llvm::SmallPtrSetImpl<Constraint *> &getAllConstraints() {
     return Constraints;
   }
 
@@ -156,8 +164,9 @@ private:
   std::string Name;
   const VarKind KindV;
   // The constraint expressions where this variable is mentioned on the
-  // LHS of an equality.
-  std::set<Constraint *, PComp<Constraint *>> Constraints;
+  // LHS of an equality. Constraints are deduplicated by Constraints before
+  // they get here, so pointer identity is enough.
+  llvm::SmallPtrSet<Constraint *, 4> Constraints;
 };
 
 /* ConstAtom ordering is:
@@ -176,7 +185,7 @@ public:
 
   void dump(void) const override { print(llvm::errs()); }
 
-  void dumpJson(llvm::raw_ostream &O) const override { O << "\"NTARR\""; }
+  void dumpJson(llvm::json::OStream &J) const override { J.value("NTARR"); }
 
   bool operator==(const Atom &Other) const override {
     return llvm::isa<NTArrAtom>(&Other);
@@ -200,7 +209,7 @@ public:
 
   void dump(void) const override { print(llvm::errs()); }
 
-  void dumpJson(llvm::raw_ostream &O) const override { O << "\"ARR\""; }
+  void dumpJson(llvm::json::OStream &J) const override { J.value("ARR"); }
 
   bool operator==(const Atom &Other) const override {
     return llvm::isa<ArrAtom>(&Other);
@@ -226,7 +235,7 @@ public:
 
   void dump(void) const override { print(llvm::errs()); }
 
-  void dumpJson(llvm::raw_ostream &O) const override { O << "\"PTR\""; }
+  void dumpJson(llvm::json::OStream &J) const override { J.value("PTR"); }
 
   bool operator==(const Atom &Other) const override {
     return llvm::isa<PtrAtom>(&Other);
@@ -253,7 +262,7 @@ public:
 
   void dump(void) const override { print(llvm::errs()); }
 
-  void dumpJson(llvm::raw_ostream &O) const override { O << "\"WILD\""; }
+  void dumpJson(llvm::json::OStream &J) const override { J.value("WILD"); }
 
   bool operator==(const Atom &Other) const override {
     return llvm::isa<WildAtom>(&Other);
@@ -301,7 +310,7 @@ public:
 
   virtual void print(llvm::raw_ostream &) const = 0;
   virtual void dump(void) const = 0;
-  virtual void dumpJson(llvm::raw_ostream &) const = 0;
+  virtual void dumpJson(llvm::json::OStream &) const = 0;
   virtual bool operator==(const Constraint &Other) const = 0;
   virtual bool operator!=(const Constraint &Other) const = 0;
   virtual bool operator<(const Constraint &Other) const = 0;
@@ -347,17 +356,19 @@ public:
 
   void dump(void) const override { print(llvm::errs()); }
 
-  void dumpJson(llvm::raw_ostream &O) const override {
-    O << "{\"Geq\":{\"Atom1\":";
-    Lhs->dumpJson(O);
-    O << ", \"Atom2\":";
-    Rhs->dumpJson(O);
-    O << ", \"isChecked\":";
-    O << (IsCheckedConstraint ? "true" : "false");
-    O << ", \"Reason\":";
-    llvm::json::Value ReasonVal(getReasonText());
-    O << ReasonVal;
-    O << "}}";
+  void dumpJson(llvm::json::OStream &J) const override {
+    J.object([&] {
+      J.attributeObject("Geq", [&] {
+        J.attributeBegin("Atom1");
+        Lhs->dumpJson(J);
+        J.attributeEnd();
+        J.attributeBegin("Atom2");
+        Rhs->dumpJson(J);
+        J.attributeEnd();
+        J.attribute("isChecked", IsCheckedConstraint);
+        J.attribute("Reason", getReasonText());
+      });
+    });
   }
 
   Atom *getLHS(void) const { return Lhs; }
@@ -431,7 +442,9 @@ public:
   const EnvironmentMap &getVariables() const { return Environment; }
   void dump() const;
   void print(llvm::raw_ostream &) const;
-  void dumpJson(llvm::raw_ostream &) const;
+  void dumpJson(llvm::json::OStream &J) const;
+  // Write each variable's solution as a line of newline-delimited JSON.
+  void dumpNDJson(llvm::raw_ostream &O) const;
   /* constraint variable generation */
   VarAtom *getFreshVar(VarSolTy InitC, std::string Name, VarAtom::VarKind VK);
   VarAtom *getOrCreateVar(ConstraintKey V, VarSolTy InitC, std::string Name,
@@ -448,9 +461,15 @@ public:
   std::set<VarAtom *> filterAtoms(VarAtomPred Pred);
 
 private:
+  // VarAtoms live as long as the environment and are never freed
+  // individually, so they are bump allocated.
+  llvm::SpecificBumpPtrAllocator<VarAtom> VarAtomAllocator;
   EnvironmentMap Environment; // Solution map: Var --> Sol
   uint32_t ConsFreeKey;       // Next available integer to assign to a Var
   bool UseChecked;            // Which solution map to use -- checked (vs. ptyp)
+
+  static void dumpEntryJson(llvm::json::OStream &J,
+                            const EnvironmentMap::value_type &V);
 };
 
 class ConstraintVariable;
@@ -470,6 +489,14 @@ public:
 
   bool removeConstraint(Constraint *C);
   bool addConstraint(Constraint *C);
+  // Between these calls, addConstraint only checks a new constraint against
+  // the hashed index of the constraints and queues it. The queued constraints
+  // are added to the constraint set, the graphs, the reason map and their
+  // atoms in one pass by commitConstraintBatch, with the same result as
+  // adding them one at a time. Nothing may read the constraints or the graphs
+  // while a batch is open.
+  void beginConstraintBatch();
+  void commitConstraintBatch();
   // It's important to return these by reference. Programs can have
   // 10-100-100000 constraints and variables, and copying them each time
   // a client wants to examine the environment is untenable.
@@ -481,12 +508,22 @@ public:
   void editConstraintHook(Constraint *C);
 
   void solve();
+  // Update the solution after the given constraints were removed with
+  // removeConstraint, without solving the whole system again. Returns false,
+  // leaving the solution untouched, if the update cannot be done
+  // incrementally; the caller must then reset the environment and solve.
+  bool solveAfterRemoval(const ConstraintSet &Removed);
   void dump() const;
   void print(llvm::raw_ostream &) const;
-  void dumpJson(llvm::raw_ostream &) const;
+  void dumpJson(llvm::json::OStream &J) const;
+  // Write each constraint, then each variable's solution, as a line of
+  // newline-delimited JSON.
+  void dumpNDJson(llvm::raw_ostream &O) const;
 
   Geq *createGeq(Atom *Lhs, Atom *Rhs, ReasonLoc Rsn,
                  bool IsCheckedConstraint = true, bool Soft = false);
+  // The constraint Lhs >= Rhs of the given kind, if it is in the system.
+  Geq *getGeq(Atom *Lhs, Atom *Rhs, bool IsCheckedConstraint = true) const;
 
   VarAtom *createFreshGEQ(std::string Name, VarAtom::VarKind VK, ConstAtom *Con,
                           ReasonLoc Rsn = ReasonLoc());
@@ -512,16 +549,49 @@ public:
                                     ConstraintSet &RemovedCons);
 
 private:
+  // Every Geq is allocated here by createGeq and is released only when the
+  // whole constraint system is destroyed, including constraints that were
+  // rejected as duplicates or later removed.
+  llvm::SpecificBumpPtrAllocator<Geq> GeqAllocator;
+  // Hashed index of TheConstraints keyed on (LHS, RHS), one per constraint
+  // kind. Atoms are unique (VarAtoms per key, ConstAtoms are the prebuilt
+  // singletons), so pointer equality here matches Geq::operator==.
+  typedef llvm::DenseMap<std::pair<Atom *, Atom *>, Geq *> GeqIndexMap;
+  GeqIndexMap CheckedGeqs;
+  GeqIndexMap PtrTypGeqs;
+  GeqIndexMap &getGeqIndex(const Geq *G) {
+    return G->constraintIsChecked() ? CheckedGeqs : PtrTypGeqs;
+  }
+
   ConstraintSet TheConstraints;
   // These are constraint graph representation of constraints.
   ConstraintsGraph *ChkCG;
   ConstraintsGraph *PtrTypCG;
-  std::map<std::string, ConstraintSet> ConstraintsByReason;
+  // Reason strings are interned to indices into ConstraintsByReason, so that
+  // each constraint costs one hashed lookup of its reason.
+  static const unsigned NoReason = ~0U;
+  llvm::StringMap<unsigned> ReasonIds;
+  std::vector<ConstraintSet> ConstraintsByReason;
+  // The constraints added since beginConstraintBatch, with the reason id they
+  // were added under (a later duplicate can change the reason of the stored
+  // constraint, but not the entry of ConstraintsByReason that holds it).
+  bool BatchOpen = false;
+  std::vector<std::pair<Geq *, unsigned>> PendingGeqs;
   ConstraintsEnv Environment;
+  // Whether the last call to solve found a solution for every constraint.
+  // Removing constraints cannot introduce a failure, so only then can
+  // solveAfterRemoval update the solution in place.
+  bool LastSolveSucceeded = false;
+  // Atoms constrained WILD by the last solve because their pointer type
+  // constraints conflict. Removing a WILD constraint from one of these would
+  // make the next solve add it back, so that is left to a full solve.
+  std::set<Atom *> PtrTypConflictAtoms;
 
   // Managing constraints based on the underlying reason.
+  // The id under which C is listed in ConstraintsByReason, or NoReason.
+  unsigned getReasonId(Constraint *C);
   // add constraint to the map.
-  bool addReasonBasedConstraint(Constraint *C);
+  bool addReasonBasedConstraint(Constraint *C, unsigned ReasonId);
   // Remove constraint from the map.
   bool removeReasonBasedConstraint(Constraint *C);
 
@@ -13,10 +13,13 @@
 #define LLVM_CLANG_3C_CONSTRAINTSGRAPH_H
 
 #include "clang/3C/Constraints.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/BreadthFirstIterator.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DirectedGraph.h"
 #include "llvm/ADT/GraphTraits.h"
 #include "llvm/Support/GraphWriter.h"
+#include <list>
 
 template <class DataType> struct DataEdge;
 
@@ -165,11 +168,8 @@ public:
       return false;
     if (!Append)
       EdgeSet.clear();
-    llvm::SetVector<EdgeType *> Edges;
-    if (Succ)
-      Edges = N->getEdges();
-    else
-      Edges = N->getPredecessors();
+    const llvm::SetVector<EdgeType *> &Edges =
+        Succ ? N->getEdges() : N->getPredecessors();
     for (auto *E : Edges)
       if (!E->IsSoft || !IgnoreSoftEdges)
         EdgeSet.insert(E);
@@ -209,48 +209,88 @@ public:
   }
 
   NodeType *findNode(Data D) const {
-    if (NodeSet.find(D) != NodeSet.end())
-      return NodeSet.at(D);
+    auto It = NodeSet.find(D);
+    if (It != NodeSet.end())
+      return It->second;
     return nullptr;
   }
 
+  // Call Fn on every node reachable from Start (including Start), in sorted
+  // order. Reachable sets are cached, but the cache holds at most
+  // BFSCacheCapacity nodes in total across all start nodes; the least recently
+  // used sets are evicted when it is full.
   void visitBreadthFirst(Data Start, llvm::function_ref<void(Data)> Fn) const {
     NodeType *N = this->findNode(Start);
     if (N == nullptr)
       return;
-    // Insert into BFS cache.
-    if (BFSCache.find(Start) == BFSCache.end()) {
-      std::set<Data> ReachableNodes;
-      for (auto TNode : llvm::breadth_first(N)) {
-        ReachableNodes.insert(TNode->getData());
+    auto It = BFSCache.find(Start);
+    if (It != BFSCache.end()) {
+      // Mark the entry as the most recently used.
+      BFSCacheLRU.splice(BFSCacheLRU.end(), BFSCacheLRU, It->second.LRUPos);
+    } else {
+      std::vector<Data> ReachableNodes;
+      for (auto TNode : llvm::breadth_first(N))
+        ReachableNodes.push_back(TNode->getData());
+      llvm::sort(ReachableNodes);
+      BFSCacheNodes += ReachableNodes.size();
+      BFSCacheLRU.push_back(Start);
+      It = BFSCache
+               .insert({Start, {std::move(ReachableNodes),
+                                std::prev(BFSCacheLRU.end())}})
+               .first;
+      // Never evict the entry we are about to use.
+      while (BFSCacheNodes > BFSCacheCapacity && BFSCacheLRU.size() > 1) {
+        auto Victim = BFSCache.find(BFSCacheLRU.front());
+        BFSCacheNodes -= Victim->second.Reachable.size();
+        BFSCache.erase(Victim);
+        BFSCacheLRU.pop_front();
+        BFSCacheEvictions++;
       }
-      BFSCache[Start] = ReachableNodes;
     }
-    for (auto SN : BFSCache[Start])
+    for (Data SN : It->second.Reachable)
       Fn(SN);
   }
 
+  // The number of nodes currently held in the reachability cache used by
+  // visitBreadthFirst, and the number of cached sets evicted so far.
+  size_t getBFSCacheNodes() const { return BFSCacheNodes; }
+  size_t getBFSCacheEvictions() const { return BFSCacheEvictions; }
+
 protected:
   // Finds the node containing the Data if it exists, otherwise a new Node
   // is allocated. Node equality is defined only by the data stored in a node,
   // so if any node already contains the data, this node will be found.
   virtual NodeType *findOrCreateNode(Data D) {
-    if (NodeSet.find(D) != NodeSet.end())
-      return NodeSet[D];
+    NodeType *&N = NodeSet[D];
+    if (N == nullptr) {
+      N = new NodeType(D);
+      this->Nodes.push_back(N);
+    }
+    return N;
+  }
 
-    auto *NewN = new NodeType(D);
-    this->Nodes.push_back(NewN);
-    NodeSet[D] = NewN;
-    return NewN;
+  void invalidateBFSCache() {
+    BFSCache.clear();
+    BFSCacheLRU.clear();
+    BFSCacheNodes = 0;
   }
 
 private:
   template <typename G> friend struct llvm::GraphTraits;
   friend class GraphVizOutputGraph;
-  mutable std::map<Data, std::set<Data>> BFSCache;
-  std::map<Data, NodeType *> NodeSet;
-
-  void invalidateBFSCache() { BFSCache.clear(); }
+  // Bound on the total size of the cached reachable sets, chosen to keep the
+  // cache to a few tens of megabytes.
+  static const size_t BFSCacheCapacity = 1 << 22;
+  struct BFSCacheEntry {
+    std::vector<Data> Reachable;
+    typename std::list<Data>::iterator LRUPos;
+  };
+  mutable std::map<Data, BFSCacheEntry> BFSCache;
+  // Start nodes of the cached sets, least recently used first.
+  mutable std::list<Data> BFSCacheLRU;
+  mutable size_t BFSCacheNodes = 0;
+  mutable size_t BFSCacheEvictions = 0;
+  llvm::DenseMap<Data, NodeType *> NodeSet;
 };
 
 // Specialize the graph for the checked and pointer type constraint graphs. This
@@ -262,11 +302,24 @@ public:
   // Add an edge to the graph according to the Geq constraint. This is an edge
   // RHSAtom -> LHSAtom
   void addConstraint(Geq *C, const Constraints &CS);
+  // Add the edges of the constraints Cs in order, as addConstraint would.
+  void addConstraints(llvm::ArrayRef<Geq *> Cs, const Constraints &CS);
 
   // Const atoms are the starting points for the solving algorithm so, we need
   // be able to retrieve them from the graph.
   std::set<ConstAtom *> &getAllConstAtoms();
 
+  // Call Fn once on every atom reachable from at least one of Roots (including
+  // the roots themselves) with the sorted indices into Roots of the roots that
+  // reach it. This is equivalent to a breadth first search from each root, but
+  // the labels are propagated in a single pass over the strongly connected
+  // components of the reachable part of the graph, so the cost is proportional
+  // to the size of the output rather than to the number of roots times the size
+  // of the graph.
+  void visitReachingRoots(
+      llvm::ArrayRef<Atom *> Roots,
+      llvm::function_ref<void(Atom *, llvm::ArrayRef<unsigned>)> Fn) const;
+
   typedef DataEdge<Atom*> EdgeType;
 protected:
   // Add vertex is overridden to save const atoms as they are added to the graph
@@ -277,6 +330,66 @@ private:
   std::set<ConstAtom *> AllConstAtoms;
 };
 
+// A read-only snapshot of a ConstraintsGraph in compressed sparse row form,
+// used by the solver for its traversals. The atoms of the graph are numbered
+// densely in node order, and the neighbors of each atom are stored contiguously
+// as indices, so a traversal touches a few flat arrays instead of a heap object
+// per node and edge. Edges into ConstAtoms are omitted because solutions never
+// propagate into them. The snapshot must be rebuilt if the graph changes.
+class CompactConstraintsGraph {
+public:
+  explicit CompactConstraintsGraph(ConstraintsGraph &CG);
+
+  unsigned size() const { return Atoms.size(); }
+  Atom *getAtom(unsigned Idx) const { return Atoms[Idx]; }
+  // Returns false if the atom has no node in the graph.
+  bool findIndex(Atom *A, unsigned &Idx) const;
+  const std::vector<unsigned> &getConstAtoms() const { return ConstAtoms; }
+
+  // The VarAtoms with an edge from (Succ) or to (!Succ) the given atom.
+  llvm::ArrayRef<unsigned> getNeighbors(unsigned Idx, bool Succ,
+                                        bool IgnoreSoftEdges = false) const;
+
+  // The topological rank of the atom's strongly connected component when
+  // following edges in the given direction: if there is a path from atom A to
+  // atom B and they are in different components, A has the smaller rank.
+  unsigned getComponentRank(unsigned Idx, bool Succ) const {
+    return Succ ? Rank[Idx] : NumComponents - 1 - Rank[Idx];
+  }
+
+  // The weakly connected components of the graph without its ConstAtoms,
+  // numbered in the order of their first atom. The solver never changes the
+  // solution of a ConstAtom, so solutions only flow within these components,
+  // and ConstAtoms belong to none of them (NoComponent).
+  static const unsigned NoComponent = ~0U;
+  unsigned getNumVarComponents() const { return NumVarComponents; }
+  unsigned getVarComponent(unsigned Idx) const { return VarComponent[Idx]; }
+
+private:
+  // The neighbors of atom I are Targets[Offsets[I]] to
+  // Targets[Offsets[I + 1] - 1], with those reached by hard edges first, up to
+  // HardEnd[I].
+  struct Adjacency {
+    std::vector<unsigned> Offsets;
+    std::vector<unsigned> HardEnd;
+    std::vector<unsigned> Targets;
+  };
+
+  std::vector<Atom *> Atoms;
+  llvm::DenseMap<Atom *, unsigned> Index;
+  std::vector<unsigned> ConstAtoms;
+  Adjacency Succs;
+  Adjacency Preds;
+  std::vector<unsigned> Rank;
+  unsigned NumComponents = 0;
+  std::vector<unsigned> VarComponent;
+  unsigned NumVarComponents = 0;
+
+  void buildAdjacency(ConstraintsGraph &CG, bool Succ, Adjacency &Adj);
+  void rankComponents();
+  void findVarComponents();
+};
+
 // Below this point we define a graph class specialized for generating the
 // graphviz output for the combine checked and ptype graphs.
 
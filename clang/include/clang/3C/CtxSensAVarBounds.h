@@ -20,17 +20,32 @@
 #include "clang/3C/PersistentSourceLoc.h"
 #include "clang/3C/ProgramVar.h"
 #include "clang/AST/Decl.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
 
 class ProgramInfo;
 class ConstraintResolver;
 
 class AVarBoundsInfo;
-typedef std::map<std::string, std::map<BoundsKey, BoundsKey>> CtxStKeyMap;
-typedef std::map<PersistentSourceLoc, std::map<BoundsKey, BoundsKey>>
-    CtxCEKeyMap;
+
+// Identifies a context in which context-sensitive bounds keys are created:
+// either a call site (or a group of equivalent call sites) or a struct access
+// path.
+typedef unsigned CtxId;
+// Context-sensitive copies of bounds keys, keyed by the context and the
+// original bounds key.
+typedef llvm::DenseMap<std::pair<CtxId, BoundsKey>, BoundsKey> CtxKeyMap;
 
 // This handles handles all the context-sensitive portions of array bounds
 // inference.
+//
+// Every context gets a copy of the bounds keys of the callee parameters and
+// return (or of the struct fields), so the number of keys grows with the
+// number of call sites of each function. To keep this tractable, a call with
+// the same callee and the same variable or constant arguments as an earlier
+// call shares the context of that call, and a callee (or struct) with
+// -max-ctx-per-callee contexts gets no more; its other call sites (or access
+// paths) use the context-insensitive keys.
 class CtxSensitiveBoundsKeyHandler {
 public:
   CtxSensitiveBoundsKeyHandler(AVarBoundsInfo *ABInfo) : ABI(ABInfo) {
@@ -41,9 +56,9 @@ public:
                               const ProgramVarScope *NPS);
 
   // Create context sensitive bounds key with scope NPS for OK bounds key
-  // and store the newly created bounds key in CBMap.
+  // in the context Ctx.
   void createCtxSensBoundsKey(BoundsKey OK, const ProgramVarScope *NPS,
-                              std::map<BoundsKey, BoundsKey> &CBMap);
+                              CtxId Ctx);
   // Create context sensitive BoundsKey for struct member access.
   void contextualizeCVar(MemberExpr *ME, ASTContext *C, ProgramInfo &I);
 
@@ -59,8 +74,9 @@ public:
   // This function return true if success.
   bool tryGetMECSKey(MemberExpr *ME, ASTContext *C, ProgramInfo &I,
                      BoundsKey &CSKey);
-  // Get context sensitive bounds key for a given FieldDecl,
-  bool tryGetFieldCSKey(FieldDecl *FD, CtxStKeyMap *CSK, const std::string &AK,
+  // Get context sensitive bounds key for a given FieldDecl accessed through
+  // the access path AK.
+  bool tryGetFieldCSKey(FieldDecl *FD, bool IsGlobal, const std::string &AK,
                         ASTContext *C, ProgramInfo &I, BoundsKey &CSKey);
 
   // Get context sensitive bounds key for BK at PSL.
@@ -74,23 +90,53 @@ public:
                                         const std::set<BoundsKey> &CSRKeys,
                                         ASTContext *C, ConstraintResolver *CR);
 
-  CtxStKeyMap *getCtxStKeyMap(bool IsGlobal);
+  // Number of contexts created, of call sites that shared the context of an
+  // equivalent call site, and of call sites or struct access paths that got no
+  // context because of -max-ctx-per-callee.
+  unsigned getNumContexts() const { return NextCtx; }
+  unsigned getNumMergedContexts() const { return NumMerged; }
+  unsigned getNumCappedContexts() const { return NumCapped; }
+  // Number of context-sensitive bounds keys.
+  unsigned getNumCtxSensKeys() const { return CtxKeys.size(); }
 
 private:
   void clearAll() {
-    CSBoundsKey.clear();
-    LocalMEBoundsKey.clear();
-    GlobalMEBoundsKey.clear();
+    CtxKeys.clear();
+    CallSiteCtx.clear();
+    CallCtxBySignature.clear();
+    LocalStructCtx.clear();
+    GlobalStructCtx.clear();
+    CtxPerCallee.clear();
+    CtxPerStruct.clear();
+    NextCtx = NumMerged = NumCapped = 0;
   }
 
-  // Get the map (i.e., local or global) where the context-sensitive
-  // bounds key for ME should be stored.
-  CtxStKeyMap *getCtxStKeyMap(MemberExpr *ME, ASTContext *C);
+  // Get the context of the call CE to the function FV, creating it if needed.
+  // Returns false if the call has no context because FV already has the
+  // maximum number of contexts.
+  bool getCallCtx(CallExpr *CE, const FVConstraint *FV, ASTContext *C,
+                  CtxId &Ctx);
+
+  // Get the keys of the arguments of CE into Sig. Returns false unless every
+  // argument is a variable or an integer constant.
+  bool getCallSignature(CallExpr *CE, ASTContext *C,
+                        std::vector<BoundsKey> &Sig);
+
+  // Get the context of the access path AK of a struct named SName, creating
+  // it if Create is set. Returns false if there is no such context.
+  bool getStructCtx(const std::string &SName, const std::string &AK,
+                    bool IsGlobal, bool Create, CtxId &Ctx);
+
+  // Get the copy of BK in the context Ctx.
+  bool tryGetCtxKey(CtxId Ctx, BoundsKey BK, BoundsKey &CSKey) const;
+
+  // Get whether the context-sensitive keys for ME are those of global struct
+  // variables.
+  bool isGlobalAccess(MemberExpr *ME, ASTContext *C);
 
   void contextualizeStructRecord(ProgramInfo &I, ASTContext *C,
                                  const RecordDecl *RD, const std::string &AK,
-                                 std::map<BoundsKey, BoundsKey> &BKMap,
-                                 bool IsGlobal);
+                                 CtxId Ctx, bool IsGlobal);
 
   void contextualizeCVar(RecordDecl *RD, std::string AccessKey, bool IsGlobal,
                          ASTContext *C, ProgramInfo &I);
@@ -104,15 +150,24 @@ private:
   bool deriveBoundsKeys(clang::Expr *E, const CVarSet &CVars, ASTContext *C,
                         ConstraintResolver *CR, std::set<BoundsKey> &AllKeys);
 
-  // Context sensitive bounds key.
-  // For each call-site a map of original bounds key and the bounds key
-  // specific to this call-site.
-  CtxCEKeyMap CSBoundsKey;
-  // Context-sensitive keys for member access of a function local
-  // struct variable.
-  CtxStKeyMap LocalMEBoundsKey;
-  // Context-sensitive keys for member access of a global struct variable.
-  CtxStKeyMap GlobalMEBoundsKey;
+  // The context-sensitive bounds keys of all contexts.
+  CtxKeyMap CtxKeys;
+  // The context of each call site.
+  llvm::DenseMap<PersistentSourceLoc, CtxId> CallSiteCtx;
+  // The context of each call whose arguments are all variables or constants,
+  // by callee and argument keys.
+  std::map<std::pair<const FVConstraint *, std::vector<BoundsKey>>, CtxId>
+      CallCtxBySignature;
+  // The contexts of member accesses of function local struct variables and of
+  // global struct variables, by access path.
+  llvm::StringMap<CtxId> LocalStructCtx;
+  llvm::StringMap<CtxId> GlobalStructCtx;
+  // Number of contexts of each callee and of each struct.
+  llvm::DenseMap<const FVConstraint *, unsigned> CtxPerCallee;
+  llvm::StringMap<unsigned> CtxPerStruct;
+  CtxId NextCtx;
+  unsigned NumMerged;
+  unsigned NumCapped;
   AVarBoundsInfo *ABI;
 };
 
@@ -22,42 +22,61 @@
 #include "clang/Rewrite/Core/Rewriter.h"
 #include "clang/Tooling/CommonOptionsParser.h"
 #include "clang/Tooling/Tooling.h"
+#include "llvm/ADT/DenseMapInfo.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 
+// PersistentSourceLoc is a small trivially copyable value. The file name is
+// interned in a program-wide string pool (see internString in Utils.h), so the
+// interned pointer acts as a file id: two locations are in the same file iff
+// their names share storage. Comparisons and hashing therefore only look at
+// integers, except when ordering locations from two different files, which
+// still orders by path so that maps keyed on locations iterate in the same
+// order as before.
 class PersistentSourceLoc {
 protected:
-  PersistentSourceLoc(std::string F, uint32_t L, uint32_t C, uint32_t E)
+  // F must be an interned file name.
+  PersistentSourceLoc(llvm::StringRef F, uint32_t L, uint32_t C, uint32_t E)
       : FileName(F), LineNo(L), ColNoS(C), ColNoE(E), IsValid(true) {}
 
 public:
   PersistentSourceLoc()
-      : FileName(""), LineNo(0), ColNoS(0), ColNoE(0), IsValid(false) {}
-  std::string getFileName() const { return FileName; }
+      : FileName(), LineNo(0), ColNoS(0), ColNoE(0), IsValid(false) {}
+  std::string getFileName() const { return FileName.str(); }
   uint32_t getLineNo() const { return LineNo; }
   uint32_t getColSNo() const { return ColNoS; }
   uint32_t getColENo() const { return ColNoE; }
   bool valid() const { return IsValid; }
 
+  bool sameFile(const PersistentSourceLoc &O) const {
+    return FileName.data() == O.FileName.data();
+  }
+
+  bool operator==(const PersistentSourceLoc &O) const {
+    return sameFile(O) && LineNo == O.LineNo && ColNoS == O.ColNoS &&
+           ColNoE == O.ColNoE;
+  }
+
+  bool operator!=(const PersistentSourceLoc &O) const { return !(*this == O); }
+
   bool operator<(const PersistentSourceLoc &O) const {
-    if (FileName == O.FileName)
-      if (LineNo == O.LineNo)
-        if (ColNoS == O.ColNoS)
-          if (ColNoE == O.ColNoE)
-            return false;
-          else
-            return ColNoE < O.ColNoE;
-        else
-          return ColNoS < O.ColNoS;
-      else
-        return LineNo < O.LineNo;
-    else
+    if (!sameFile(O))
       return FileName < O.FileName;
+    if (LineNo != O.LineNo)
+      return LineNo < O.LineNo;
+    if (ColNoS != O.ColNoS)
+      return ColNoS < O.ColNoS;
+    return ColNoE < O.ColNoE;
+  }
+
+  unsigned getHashValue() const {
+    return llvm::hash_combine(FileName.data(), LineNo, ColNoS, ColNoE);
   }
 
   std::string toString() const {
-    return FileName + ":" + std::to_string(LineNo) + ":" +
+    return FileName.str() + ":" + std::to_string(LineNo) + ":" +
            std::to_string(ColNoS) + ":" + std::to_string(ColNoE);
   }
 
@@ -74,14 +93,29 @@ public:
   static PersistentSourceLoc mkPSL(const clang::Expr *E,
                                    const clang::ASTContext &Context);
 
+  // Let mkPSL remember the interned name of each file of Context, so that it
+  // does no string work after the first location in a file. The names are
+  // forgotten when Context is destroyed. Must not be called while mkPSL may
+  // be running on another thread. Until then, mkPSL on Context computes the
+  // name every time.
+  static void cacheFileNames(const clang::ASTContext &Context);
+
+  // Distinct invalid locations that never compare equal to a location built
+  // by mkPSL or the default constructor. Used as DenseMap sentinels.
+  static PersistentSourceLoc mkSentinel(uint32_t Marker) {
+    PersistentSourceLoc PSL;
+    PSL.LineNo = Marker;
+    return PSL;
+  }
+
 private:
   // Create a PersistentSourceLoc based on absolute file path
   // from the given SourceRange and SourceLocation.
   static PersistentSourceLoc mkPSL(clang::SourceRange SR,
                                    clang::SourceLocation SL,
                                    const clang::ASTContext &Context);
-  // The source file name.
-  std::string FileName;
+  // The source file name, interned.
+  llvm::StringRef FileName;
   // Starting line number.
   uint32_t LineNo;
   // Column number start.
@@ -91,6 +125,24 @@ private:
   bool IsValid;
 };
 
+namespace llvm {
+template <> struct DenseMapInfo<PersistentSourceLoc> {
+  static PersistentSourceLoc getEmptyKey() {
+    return PersistentSourceLoc::mkSentinel(~0U);
+  }
+  static PersistentSourceLoc getTombstoneKey() {
+    return PersistentSourceLoc::mkSentinel(~0U - 1);
+  }
+  static unsigned getHashValue(const PersistentSourceLoc &PSL) {
+    return PSL.getHashValue();
+  }
+  static bool isEqual(const PersistentSourceLoc &L,
+                      const PersistentSourceLoc &R) {
+    return L == R;
+  }
+};
+} // namespace llvm
+
 typedef std::pair<PersistentSourceLoc, PersistentSourceLoc>
     PersistentSourceRange;
 
@@ -23,12 +23,13 @@
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Frontend/FrontendAction.h"
 #include "clang/Tooling/Tooling.h"
+#include "llvm/Support/JSON.h"
 
 class ProgramVariableAdder {
 public:
   virtual void addVariable(clang::DeclaratorDecl *D,
                            clang::ASTContext *AstContext) = 0;
-  void addABoundsVariable(clang::Decl *D) {
+  virtual void addABoundsVariable(clang::Decl *D) {
     getABoundsInfo().insertVariable(D);
   }
 
@@ -43,6 +44,10 @@ protected:
 
 typedef std::pair<CVarSet, BKeySet> CSetBkeyPair;
 
+// Printed types (qtyToStr), keyed by the type and the name printed with it.
+typedef llvm::DenseMap<std::pair<void *, llvm::StringRef>, std::string>
+    TypeStringMap;
+
 // The pair of CVs are the type param constraint and an optional
 // constraint used to get the generic index. A better solution would have
 // generic constraints saved within ConstraintVariables, but those don't
@@ -85,6 +90,9 @@ public:
   void print(llvm::raw_ostream &O) const;
   void dump() const { print(llvm::errs()); }
   void dumpJson(llvm::raw_ostream &O) const;
+  // The same information as dumpJson, one record per line (see
+  // writeNDJsonLine).
+  void dumpNDJson(llvm::raw_ostream &O) const;
   void dumpStats(const std::set<std::string> &F) {
     printStats(F, llvm::errs());
   }
@@ -141,6 +149,10 @@ public:
 
   ConstraintsInfo &getInterimConstraintState() { return CState; }
   bool computeInterimConstraintState(const std::set<std::string> &FilePaths);
+  // Update the interim constraint state after the constraints that made the
+  // given atoms directly WILD were removed and the solution was updated in
+  // place, instead of recomputing it.
+  void removeWildRootsFromInterimState(const std::set<VarAtom *> &FormerRoots);
 
   const ExternalFunctionMapType &getExternFuncDefFVMap() const {
     return ExternalFunctionFVCons;
@@ -173,11 +185,30 @@ public:
   void addTypedef(PersistentSourceLoc PSL, bool CanRewriteDef, TypedefDecl *TD,
                   ASTContext &C) override;
 
-  // Store mapping from ASTContexts to a unique index in the ASTs vector in
-  // the ProgramInfo object. This function must be called prior to any AST
-  // traversals so that the map is populated.
-  void registerTranslationUnits(
-      const std::vector<std::unique_ptr<clang::ASTUnit>> &ASTs);
+  // Store mapping from an ASTContext to its unique index in the ASTs vector in
+  // the ProgramInfo object. This function must be called for each translation
+  // unit prior to any traversal of its AST so that the map is populated. When
+  // 3C re-parses a translation unit whose AST was evicted (-max-resident-asts),
+  // the new ASTContext is registered under the same index.
+  void registerTranslationUnit(clang::ASTContext *C, unsigned int Idx);
+  // Forget the ASTContext of a translation unit whose AST is being destroyed,
+  // so that a later ASTContext allocated at the same address is not mistaken
+  // for it.
+  void unregisterTranslationUnit(clang::ASTContext *C);
+
+  // addVariable with the PersistentSourceLoc of D already computed, as
+  // VariableAdderShard does on its worker thread.
+  void addVariable(clang::DeclaratorDecl *D, clang::ASTContext *AstContext,
+                   const PersistentSourceLoc &PLoc);
+  // qtyToStr(QT, Name). While a VariableAdderShard is merged, the strings it
+  // printed on its worker thread are used instead of printing them again.
+  std::string getTypeString(clang::QualType QT,
+                            llvm::StringRef Name = "") const;
+  // Set (or, with null, clear) the strings used by getTypeString. They must
+  // belong to the translation unit that is being entered.
+  void setPrecomputedTypeStrings(const TypeStringMap *Strings) {
+    PrecomputedTypeStrings = Strings;
+  }
 
 private:
   // List of constraint variables for declarations, indexed by their location in
@@ -188,7 +219,7 @@ private:
   // Map storing constraint information for typedefed types
   // The set contains all the constraint variables that also use this tyepdef
   // rewritten.
-  std::map<PersistentSourceLoc, CVarOption> TypedefVars;
+  llvm::DenseMap<PersistentSourceLoc, CVarOption> TypedefVars;
 
   // A pair containing an AST node ID and an index that uniquely identifies the
   // translation unit. Translation unit identifiers are drawn from the
@@ -198,18 +229,21 @@ private:
   IDAndTranslationUnit getExprKey(clang::Expr *E, clang::ASTContext *C) const;
 
   // Map with the similar purpose as the Variables map. This stores a set of
-  // constraint variables and bounds key for non-declaration expressions.
-  std::map<IDAndTranslationUnit, CSetBkeyPair> ExprConstraintVars;
+  // constraint variables and bounds key for non-declaration expressions. This
+  // and the other maps keyed on expressions are hashed because they are
+  // queried for nearly every expression; code that needs a deterministic
+  // order must sort the keys first.
+  llvm::DenseMap<IDAndTranslationUnit, CSetBkeyPair> ExprConstraintVars;
 
   // For each expr stored in the ExprConstraintVars, also store the source
   // location for the expression. This is used to emit diagnostics. It is
   // expected that multiple entries will map to the same source location.
-  std::map<IDAndTranslationUnit, PersistentSourceLoc> ExprLocations;
+  llvm::DenseMap<IDAndTranslationUnit, PersistentSourceLoc> ExprLocations;
 
   // This map holds similar information as the type variable map in
   // ConstraintBuilder.cpp, but it is stored in a form that is usable during
   // rewriting.
-  typedef std::map<IDAndTranslationUnit, CallTypeParamBindingsT>
+  typedef llvm::DenseMap<IDAndTranslationUnit, CallTypeParamBindingsT>
       TypeParamBindingsT;
 
   std::map<ConstraintKey, PersistentSourceLoc> DeletedAtomLocations;
@@ -221,6 +255,7 @@ private:
   Constraints CS;
   // Is the ProgramInfo persisted? Only tested in asserts. Starts at true.
   bool Persisted;
+  const TypeStringMap *PrecomputedTypeStrings = nullptr;
 
   // Map of global decls for which we don't have a definition, the keys are
   // names of external vars, the value is whether the def
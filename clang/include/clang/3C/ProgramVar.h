@@ -16,6 +16,9 @@
 
 #include "clang/3C/PersistentSourceLoc.h"
 #include "clang/AST/ASTContext.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
+#include <memory>
 #include <stdint.h>
 #include <string>
 
@@ -60,14 +63,6 @@ public:
   virtual std::string getStr() const = 0;
 };
 
-class PVSComp {
-public:
-  bool operator()(const ProgramVarScope &Lhs,
-                  const ProgramVarScope &Rhs) const {
-    return Lhs < Rhs;
-  }
-};
-
 // Scope for all global variables and program constants.
 class GlobalScope : public ProgramVarScope {
 public:
@@ -92,10 +87,8 @@ public:
 
   std::string getStr() const override { return "Global"; }
 
+  // The global scope has no state, so all programs share one.
   static GlobalScope *getGlobalScope();
-
-private:
-  static GlobalScope *ProgScope;
 };
 
 class StructScope : public ProgramVarScope {
@@ -143,13 +136,8 @@ public:
 
   std::string getSName() const { return this->StName; }
 
-  static const StructScope *getStructScope(std::string StName);
-
 protected:
   std::string StName;
-
-private:
-  static std::set<StructScope, PVSComp> AllStScopes;
 };
 
 class CtxStructScope : public StructScope {
@@ -201,13 +189,9 @@ public:
     return "CtxStruct_" + ASKey + "_" + StName + "_" + std::to_string(IsG);
   }
 
-  static const CtxStructScope *getCtxStructScope(const StructScope *SS,
-                                                 std::string AS, bool IsGlobal);
-
 private:
   std::string ASKey;
   bool IsG;
-  static std::set<CtxStructScope, PVSComp> AllCtxStScopes;
 };
 
 class FunctionParamScope : public ProgramVarScope {
@@ -262,15 +246,9 @@ public:
 
   bool getIsStatic() const { return IsStatic; }
 
-  static const FunctionParamScope *getFunctionParamScope(std::string FnName,
-                                                         bool IsSt);
-
 protected:
   std::string FName;
   bool IsStatic;
-
-private:
-  static std::set<FunctionParamScope, PVSComp> AllFnParamScopes;
 };
 
 // Context-sensitive arguments scope.
@@ -337,14 +315,9 @@ public:
 
   std::string getStr() const override { return FName + "_Ctx_" + CtxIDStr; }
 
-  static const CtxFunctionArgScope *
-  getCtxFunctionParamScope(const FunctionParamScope *FPS,
-                           const PersistentSourceLoc &PSL);
-
 private:
   PersistentSourceLoc PSL; // source code location of this function call
   std::string CtxIDStr;
-  static std::set<CtxFunctionArgScope, PVSComp> AllCtxFnArgScopes;
 };
 
 class FunctionScope : public ProgramVarScope {
@@ -394,13 +367,43 @@ public:
 
   std::string getStr() const override { return "InFunc_" + FName; }
 
-  static const FunctionScope *getFunctionScope(std::string FnName, bool IsSt);
-
 private:
   std::string FName;
   bool IsStatic;
+};
+
+// The scopes of the program variables of one program. Each distinct scope is
+// created once, on its first request, and lives as long as the table, so
+// scopes obtained from the same table can be compared by address. The tables
+// are hashed on the fields that identify a scope.
+class ProgramVarScopeTable {
+public:
+  const StructScope *getStructScope(llvm::StringRef StName);
+
+  const CtxStructScope *getCtxStructScope(const StructScope *SS,
+                                          llvm::StringRef AS, bool IsGlobal);
 
-  static std::set<FunctionScope, PVSComp> AllFnScopes;
+  const FunctionParamScope *getFunctionParamScope(llvm::StringRef FnName,
+                                                  bool IsSt);
+
+  const CtxFunctionArgScope *
+  getCtxFunctionParamScope(const FunctionParamScope *FPS,
+                           const PersistentSourceLoc &PSL);
+
+  const FunctionScope *getFunctionScope(llvm::StringRef FnName, bool IsSt);
+
+private:
+  // StringMap entries do not move, so the scopes are stored in place. The
+  // tables of function and context-sensitive struct scopes are indexed by
+  // IsStatic and IsGlobal respectively.
+  llvm::StringMap<StructScope> StScopes;
+  // Keyed by "<struct name>:<access key>".
+  llvm::StringMap<CtxStructScope> CtxStScopes[2];
+  llvm::StringMap<FunctionParamScope> FnParamScopes[2];
+  llvm::StringMap<FunctionScope> FnScopes[2];
+  llvm::DenseMap<std::pair<const FunctionParamScope *, PersistentSourceLoc>,
+                 std::unique_ptr<CtxFunctionArgScope>>
+      CtxFnArgScopes;
 };
 
 // Class that represents a program variable along with its scope.
@@ -435,7 +438,6 @@ private:
 
   // TODO: All the ProgramVars may not be used. We should try to figure out
   //  a way to free unused program vars.
-  static std::set<const ProgramVar *> AllProgramVars;
 
   ProgramVar(BoundsKey K, const std::string &VarName,
              const ProgramVarScope *VScope, bool IsConstant,
@@ -446,7 +448,6 @@ private:
     // change happens this should sanity check how ProgramVars are constructed.
     assert("Constant value should not be set for non-constant variables." &&
            (IsConstant || ConstantVal == 0));
-    AllProgramVars.insert(this);
   }
 
   ProgramVar(BoundsKey VK, std::string VName, const ProgramVarScope *PVS)
@@ -143,16 +143,47 @@ private:
   ProgramInfo &Info;
 };
 
+// The new version of a file generated by RewriteConsumer.
+struct RewrittenFile {
+  // Canonical path of the file that the new version replaces.
+  std::string SourceFile;
+  std::string NewContents;
+};
+
 class RewriteConsumer : public ASTConsumer {
 public:
   explicit RewriteConsumer(ProgramInfo &I) : Info(I) {}
 
   void HandleTranslationUnit(ASTContext &Context) override;
 
+  // Write the new versions of the files for which IsFinished returns true
+  // given the canonical path of the file they replace, i.e. the files that no
+  // translation unit still to be handled includes, and keep the others. Each
+  // file is thus written exactly once, even if it is a header that was
+  // rewritten by several translation units. Context must be the translation
+  // unit just handled, which includes all of those files; failures are
+  // reported through its diagnostics.
+  void writeFinishedFiles(ASTContext &Context,
+                          llvm::function_ref<bool(llvm::StringRef)> IsFinished);
+
+  // Return the new versions of the files changed by the translation units
+  // handled so far, keyed by output path, instead of writing them.
+  std::map<std::string, RewrittenFile> takeChangedFiles() {
+    return std::move(ChangedFiles);
+  }
+
 private:
   ProgramInfo &Info;
   static std::map<std::string, std::string> ModifiedFuncSignatures;
 
+  // New version of each output file, keyed by output path.
+  std::map<std::string, RewrittenFile> ChangedFiles;
+
+  // Write one new version, reporting a failure at the beginning of the file
+  // it replaces in the given translation unit.
+  static void writeFile(const std::string &NFile, const RewrittenFile &File,
+                        ASTContext &Context);
+
   // A single header file can be included in multiple translations units. This
   // set ensures that the diagnostics for a header file are not emitted each
   // time a translation unit containing the header is vistied.
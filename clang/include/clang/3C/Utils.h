@@ -17,6 +17,7 @@
 #include "clang/Basic/SourceLocation.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/JSON.h"
 #include <ctime>
 #include <map>
 #include <set>
@@ -84,9 +85,9 @@ template <typename T> T getOnly(const std::set<T> &SingletonSet) {
   return (*SingletonSet.begin());
 }
 
-template <typename T>
-void findIntersection(const std::set<T> &Set1, const std::set<T> &Set2,
-                      std::set<T> &Out) {
+// Set1 and Set2 can be any containers that iterate in sorted order.
+template <typename SetT1, typename SetT2, typename T>
+void findIntersection(const SetT1 &Set1, const SetT2 &Set2, std::set<T> &Out) {
   Out.clear();
   std::set_intersection(Set1.begin(), Set1.end(), Set2.begin(), Set2.end(),
                         std::inserter(Out, Out.begin()));
@@ -116,6 +117,11 @@ bool isNULLExpression(clang::Expr *E, clang::ASTContext &C);
 // Get the time spent in seconds since the provided time stamp.
 float getTimeSpentInSeconds(clock_t StartTime);
 
+// Write the single JSON value produced by Fn, followed by a newline, so that
+// O holds newline-delimited JSON that can be read one record at a time.
+void writeNDJsonLine(llvm::raw_ostream &O,
+                     llvm::function_ref<void(llvm::json::OStream &)> Fn);
+
 // Check if the function has varargs i.e., foo(<named_arg>,...)
 bool functionHasVarArgs(clang::FunctionDecl *FD);
 
@@ -148,6 +154,12 @@ std::string tyToStr(const clang::Type *T, const std::string &Name = "");
 // Same as tyToStr with a QualType.
 std::string qtyToStr(clang::QualType QT, const std::string &Name = "");
 
+// Return a copy of S owned by a process-wide string pool. Equal strings share
+// a single copy, and the returned reference stays valid until the process
+// exits. Used for type and name strings that repeat across many constraint
+// variables.
+llvm::StringRef internString(llvm::StringRef S);
+
 // Get the end source location of the end of the provided function.
 clang::SourceLocation getFunctionDeclRParen(clang::FunctionDecl *FD,
                                             clang::SourceManager &S);
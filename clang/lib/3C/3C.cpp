@@ -19,7 +19,10 @@
 #include "clang/Frontend/ASTConsumers.h"
 #include "clang/Frontend/VerifyDiagnosticConsumer.h"
 #include "clang/Tooling/ArgumentsAdjusters.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/TimeProfiler.h"
 
 using namespace clang::driver;
 using namespace clang::tooling;
@@ -149,17 +152,33 @@ public:
   }
 };
 
+// Set up the diagnostics for parsing a translation unit with the given
+// invocation.
+static IntrusiveRefCntPtr<DiagnosticsEngine>
+create3CDiagnostics(CompilerInvocation &Invocation,
+                    DiagnosticConsumer *DiagConsumer) {
+  IntrusiveRefCntPtr<DiagnosticsEngine> DiagEngine =
+      CompilerInstance::createDiagnostics(&Invocation.getDiagnosticOpts(),
+                                          DiagConsumer,
+                                          /*ShouldOwnClient=*/false);
+  // The _3CDiagnosticConsumer takes ownership of and wraps the engine's
+  // previous DiagnosticConsumer, i.e., the one created by
+  // CompilerInstance::createDiagnostics above (which will be a
+  // VerifyDiagnosticConsumer if requested via the options).
+  DiagEngine->setClient(new _3CDiagnosticConsumer(*DiagEngine));
+  return DiagEngine;
+}
+
 // Based on LibTooling's ASTBuilderAction but does several custom things that we
 // need.
 //
 // See clang/docs/checkedc/3C/clang-tidy.md#_3c-name-prefix
 // NOLINTNEXTLINE(readability-identifier-naming)
 class _3CASTBuilderAction : public ToolAction {
-  std::vector<std::unique_ptr<ASTUnit>> &ASTs;
+  _3CInterface &Interface;
 
 public:
-  _3CASTBuilderAction(std::vector<std::unique_ptr<ASTUnit>> &ASTs)
-      : ASTs(ASTs) {}
+  _3CASTBuilderAction(_3CInterface &Interface) : Interface(Interface) {}
 
   bool runInvocation(std::shared_ptr<CompilerInvocation> Invocation,
                      FileManager *Files,
@@ -233,29 +252,33 @@ public:
       }
     }
 
+    // A re-parsed translation unit gets a new SourceManager, so the
+    // `expected-*` directives seen during the first parse could not be matched
+    // against the diagnostics generated after it.
+    if (_3COpts.MaxResidentASTs != 0 &&
+        Invocation->getDiagnosticOpts().VerifyDiagnostics) {
+      errs() << "3C error: -max-resident-asts cannot be used together with "
+                "diagnostic verification\n";
+      return false;
+    }
+
     // Set up diagnostics.
     IntrusiveRefCntPtr<DiagnosticsEngine> DiagEngine =
-        CompilerInstance::createDiagnostics(&Invocation->getDiagnosticOpts(),
-                                            DiagConsumer,
-                                            /*ShouldOwnClient=*/false);
-    // The _3CDiagnosticConsumer takes ownership of and wraps the engine's
-    // previous DiagnosticConsumer, i.e., the one created by
-    // CompilerInstance::createDiagnostics above (which will be a
-    // VerifyDiagnosticConsumer if requested via the options).
-    DiagEngine->setClient(new _3CDiagnosticConsumer(*DiagEngine));
+        create3CDiagnostics(*Invocation, DiagConsumer);
 
     // Finally, actually build the AST. This part is the same as in
     // ASTBuilderAction::runInvocation.
 
     std::unique_ptr<ASTUnit> AST = ASTUnit::LoadFromCompilerInvocation(
-        Invocation, std::move(PCHContainerOps), DiagEngine, Files);
+        Invocation, PCHContainerOps, DiagEngine, Files);
     if (!AST)
       return false;
 
     handleExtraProgramAction(Invocation->getFrontendOpts(),
                              AST->getASTContext());
 
-    ASTs.push_back(std::move(AST));
+    Interface.addParsedAST(std::move(AST), Invocation, Files,
+                           std::move(PCHContainerOps));
     return true;
   }
 
@@ -308,16 +331,19 @@ private:
 void dumpConstraintOutputJson(const std::string &PostfixStr,
                               ProgramInfo &Info) {
   if (_3COpts.DumpIntermediate) {
-    std::string FilePath = _3COpts.ConstraintOutputJson + PostfixStr + ".json";
+    std::string FilePath =
+        _3COpts.ConstraintOutputJson + PostfixStr +
+        (_3COpts.ConstraintOutputNDJson ? ".ndjson" : ".json");
     errs() << "Writing json output to:" << FilePath << "\n";
     std::error_code Ec;
     llvm::raw_fd_ostream OutputJson(FilePath, Ec);
-    if (!OutputJson.has_error()) {
-      Info.dumpJson(OutputJson);
-      OutputJson.close();
-    } else {
-      Info.dumpJson(llvm::errs());
-    }
+    // The output can be several gigabytes, so it is streamed through the
+    // stream's fixed-size buffer rather than built in memory.
+    llvm::raw_ostream &O = OutputJson.has_error() ? llvm::errs() : OutputJson;
+    if (_3COpts.ConstraintOutputNDJson)
+      Info.dumpNDJson(O);
+    else
+      Info.dumpJson(O);
   }
 }
 
@@ -375,12 +401,22 @@ _3CInterface::_3CInterface(const struct _3COptions &CCopt,
     return;
   }
   if (_3COpts.OutputPostfix == "-" && _3COpts.OutputDir.empty() &&
-      SourceFileList.size() > 1) {
+      !_3COpts.Server && SourceFileList.size() > 1) {
     errs() << "3C initialization error: Cannot specify more than one input "
               "file when output is to stdout\n";
     ConstructionFailed = true;
     return;
   }
+  // The server replaces its _3CInterface after each edit, keeping only the
+  // ASTs, so neither per-process state that lives in the _3CInterface nor
+  // evicted ASTs can be carried over.
+  if (_3COpts.Server &&
+      (_3COpts.MaxResidentASTs != 0 || !_3COpts.TimeTraceFile.empty())) {
+    errs() << "3C initialization error: Cannot use -max-resident-asts or "
+              "-time-trace-file with -server\n";
+    ConstructionFailed = true;
+    return;
+  }
 
   std::string TmpPath;
   std::error_code EC;
@@ -463,18 +499,27 @@ _3CInterface::_3CInterface(const struct _3COptions &CCopt,
 
   CurrCompDB = CompDB;
 
+  // Use the default granularity of clang's -ftime-trace, in microseconds.
+  if (!_3COpts.TimeTraceFile.empty() && !timeTraceProfilerEnabled())
+    timeTraceProfilerInitialize(500, "3c");
+
   GlobalProgramInfo.getPerfStats().startTotalTime();
 }
 
 _3CInterface::~_3CInterface() {
   assert(ConstructionFailed || DeterminedExitCode);
+  if (!_3COpts.TimeTraceFile.empty() && timeTraceProfilerEnabled())
+    timeTraceProfilerCleanup();
 }
 
 bool _3CInterface::isSuccessfulSoFar() {
   if (HadNonDiagnosticError)
     return false;
   for (auto &TU : ASTs)
-    if (TU->getDiagnostics().getClient()->getNumErrors() > 0)
+    if (TU && TU->getDiagnostics().getClient()->getNumErrors() > 0)
+      return false;
+  for (auto &State : TUStates)
+    if (State.NumErrors > 0)
       return false;
   return true;
 }
@@ -487,9 +532,12 @@ int _3CInterface::determineExitCode() {
 
   bool SuccessAfterDiagnosticVerification = !HadNonDiagnosticError;
   for (auto &TU : ASTs)
-    SuccessAfterDiagnosticVerification &=
-        ((_3CDiagnosticConsumer *)TU->getDiagnostics().getClient())
-            ->finish3CAnalysis();
+    if (TU)
+      SuccessAfterDiagnosticVerification &=
+          ((_3CDiagnosticConsumer *)TU->getDiagnostics().getClient())
+              ->finish3CAnalysis();
+  for (auto &State : TUStates)
+    SuccessAfterDiagnosticVerification &= State.FinishedWithoutErrors;
 
   if (!Success && SuccessAfterDiagnosticVerification)
     // In this case, the `3c` tool will typically just have printed a "Failure
@@ -505,27 +553,194 @@ int _3CInterface::determineExitCode() {
 bool _3CInterface::parseASTs() {
 
   std::lock_guard<std::mutex> Lock(InterfaceMutex);
-
-  auto *Tool = new ClangTool(*CurrCompDB, SourceFiles);
+  TimeTraceScope TraceScope("3C parse");
+  auto &PStats = GlobalProgramInfo.getPerfStats();
 
   // load the ASTs
-  _3CASTBuilderAction Action(ASTs);
-  int ToolExitStatus = Tool->run(&Action);
-  HadNonDiagnosticError |= (ToolExitStatus != 0);
+  PStats.startCompileTime();
+  runClangTool(SourceFiles);
+  PStats.endCompileTime();
 
-  GlobalProgramInfo.registerTranslationUnits(ASTs);
+  return isSuccessfulSoFar();
+}
+
+bool _3CInterface::parseASTs(_3CInterface &Previous,
+                             const std::set<std::string> &ChangedFiles) {
+  std::lock_guard<std::mutex> Lock(InterfaceMutex);
+  TimeTraceScope TraceScope("3C parse");
+  auto &PStats = GlobalProgramInfo.getPerfStats();
+  assert(ASTs.empty() && _3COpts.Server);
+
+  PStats.startCompileTime();
+  // Main files to parse again. A compilation database may contain several
+  // translation units for one main file; ClangTool parses all of them.
+  std::set<std::string> Reparse;
+  std::set<std::string> Parsed;
+  for (unsigned Idx = 0; Idx < Previous.ASTs.size(); Idx++) {
+    const TranslationUnitFiles &Input = Previous.TUFiles[Idx];
+    Parsed.insert(Input.MainFile);
+    bool Changed = false;
+    for (const std::string &File : ChangedFiles)
+      Changed |= Input.Files.count(File) != 0;
+    if (Changed) {
+      Reparse.insert(Input.MainFile);
+      continue;
+    }
+    // The AST does not depend on the ProgramInfo it was registered with, so
+    // it can be analyzed again as is. Its diagnostics are still pending and
+    // will be finished by this _3CInterface.
+    GlobalProgramInfo.registerTranslationUnit(
+        &Previous.ASTs[Idx]->getASTContext(), ASTs.size());
+    ASTs.push_back(std::move(Previous.ASTs[Idx]));
+    TUFiles.push_back(Input);
+  }
+  for (const std::string &File : FilePaths)
+    if (!Parsed.count(File))
+      Reparse.insert(File);
+  if (_3COpts.Verbose)
+    errs() << "Re-parsing " << Reparse.size() << " of "
+           << Reparse.size() + ASTs.size() << " translation units\n";
+  runClangTool(std::vector<std::string>(Reparse.begin(), Reparse.end()));
+  PStats.endCompileTime();
 
   return isSuccessfulSoFar();
 }
 
+void _3CInterface::runClangTool(const std::vector<std::string> &Files) {
+  ClangTool Tool(*CurrCompDB, Files);
+  _3CASTBuilderAction Action(*this);
+  int ToolExitStatus = Tool.run(&Action);
+  HadNonDiagnosticError |= (ToolExitStatus != 0);
+}
+
+// Record the main file of the translation unit and the files it read.
+_3CInterface::TranslationUnitFiles _3CInterface::getTUFiles(ASTUnit &AST) {
+  TranslationUnitFiles Input;
+  Input.MainFile = AST.getMainFileName().str();
+  SourceManager &SM = AST.getSourceManager();
+  for (auto I = SM.fileinfo_begin(), E = SM.fileinfo_end(); I != E; ++I)
+    Input.Files.insert(I->first->tryGetRealPathName());
+  return Input;
+}
+
+void _3CInterface::addParsedAST(
+    std::unique_ptr<ASTUnit> AST,
+    std::shared_ptr<CompilerInvocation> Invocation, FileManager *Files,
+    std::shared_ptr<PCHContainerOperations> PCHContainerOps) {
+  unsigned Idx = ASTs.size();
+  GlobalProgramInfo.registerTranslationUnit(&AST->getASTContext(), Idx);
+  TUFiles.push_back(getTUFiles(*AST));
+  ASTs.push_back(std::move(AST));
+
+  if (_3COpts.MaxResidentASTs == 0)
+    return;
+  TranslationUnitState State;
+  State.Invocation = std::move(Invocation);
+  State.Files = Files;
+  State.PCHContainerOps = std::move(PCHContainerOps);
+  TUStates.push_back(std::move(State));
+  ResidentTUs.push_back(Idx);
+  evictASTs(_3COpts.MaxResidentASTs);
+}
+
+void _3CInterface::evictASTs(unsigned Keep) {
+  while (ResidentTUs.size() > Keep) {
+    unsigned Idx = ResidentTUs.front();
+    ResidentTUs.pop_front();
+    std::unique_ptr<ASTUnit> &AST = ASTs[Idx];
+    // The diagnostics for this instance of the translation unit are complete,
+    // so record their outcome before the DiagnosticsEngine goes away.
+    auto *DiagConsumer =
+        (_3CDiagnosticConsumer *)AST->getDiagnostics().getClient();
+    TranslationUnitState &State = TUStates[Idx];
+    State.NumErrors += DiagConsumer->getNumErrors();
+    State.FinishedWithoutErrors &= DiagConsumer->finish3CAnalysis();
+    GlobalProgramInfo.unregisterTranslationUnit(&AST->getASTContext());
+    AST.reset();
+  }
+}
+
+bool _3CInterface::reloadAST(unsigned Idx) {
+  assert(!ASTs[Idx] && "Translation unit is already resident.");
+  TranslationUnitState &State = TUStates[Idx];
+  IntrusiveRefCntPtr<DiagnosticsEngine> DiagEngine =
+      create3CDiagnostics(*State.Invocation, nullptr);
+  // Any diagnostics from parsing were reported the first time this translation
+  // unit was parsed.
+  DiagEngine->setSuppressAllDiagnostics(true);
+  // AST node IDs (see getStmtIdWorkaround) are reproducible when the same file
+  // is parsed again in the same environment, so the expression-keyed maps in
+  // ProgramInfo remain valid for the new AST.
+  std::unique_ptr<ASTUnit> AST = ASTUnit::LoadFromCompilerInvocation(
+      State.Invocation, State.PCHContainerOps, DiagEngine, State.Files.get());
+  if (!AST)
+    return false;
+  DiagEngine->setSuppressAllDiagnostics(false);
+
+  GlobalProgramInfo.registerTranslationUnit(&AST->getASTContext(), Idx);
+  ASTs[Idx] = std::move(AST);
+  ResidentTUs.push_back(Idx);
+  return true;
+}
+
+bool _3CInterface::useParallelTranslationUnits() {
+  // In bounded-memory mode, the ASTs are not all resident at once.
+  return _3COpts.NumThreads != 1 && _3COpts.MaxResidentASTs == 0 &&
+         ASTs.size() > 1;
+}
+
+void _3CInterface::forEachTranslationUnitInParallel(
+    llvm::function_ref<void(unsigned, ASTContext &)> Fn) {
+  assert(_3COpts.MaxResidentASTs == 0);
+  ThreadPool Pool(hardware_concurrency(_3COpts.NumThreads));
+  for (unsigned Idx = 0; Idx < ASTs.size(); Idx++)
+    Pool.async([this, &Fn, Idx] { Fn(Idx, ASTs[Idx]->getASTContext()); });
+  Pool.wait();
+}
+
+bool _3CInterface::forEachTranslationUnit(
+    llvm::function_ref<void(ASTContext &)> Fn) {
+  for (unsigned Idx = 0; Idx < ASTs.size(); Idx++) {
+    if (!ASTs[Idx]) {
+      evictASTs(_3COpts.MaxResidentASTs - 1);
+      if (!reloadAST(Idx)) {
+        errs() << "3C error: Failed to re-parse "
+               << TUStates[Idx].Invocation->getFrontendOpts().Inputs[0].getFile()
+               << "\n";
+        HadNonDiagnosticError = true;
+        return false;
+      }
+    }
+    Fn(ASTs[Idx]->getASTContext());
+  }
+  return true;
+}
+
 bool _3CInterface::addVariables() {
 
   std::lock_guard<std::mutex> Lock(InterfaceMutex);
+  TimeTraceScope TraceScope("3C add variables");
+  auto &PStats = GlobalProgramInfo.getPerfStats();
 
   // 1. Add Variables.
-  VariableAdderConsumer VA = VariableAdderConsumer(GlobalProgramInfo, nullptr);
-  for (auto &TU : ASTs)
-    VA.HandleTranslationUnit(TU->getASTContext());
+  PStats.startVariableAdderTime();
+  if (useParallelTranslationUnits()) {
+    // Traverse the ASTs in parallel, then add the collected variables to the
+    // ProgramInfo in translation unit order.
+    std::vector<VariableAdderShard> Shards(ASTs.size());
+    forEachTranslationUnitInParallel([&Shards](unsigned Idx, ASTContext &C) {
+      Shards[Idx].collect(C);
+    });
+    for (VariableAdderShard &Shard : Shards)
+      Shard.mergeInto(GlobalProgramInfo);
+  } else {
+    VariableAdderConsumer VA =
+        VariableAdderConsumer(GlobalProgramInfo, nullptr);
+    if (!forEachTranslationUnit(
+            [&VA](ASTContext &C) { VA.HandleTranslationUnit(C); }))
+      return false;
+  }
+  PStats.endVariableAdderTime();
 
   return isSuccessfulSoFar();
 }
@@ -533,6 +748,7 @@ bool _3CInterface::addVariables() {
 bool _3CInterface::buildInitialConstraints() {
 
   std::lock_guard<std::mutex> Lock(InterfaceMutex);
+  TimeTraceScope TraceScope("3C build constraints");
 
   if (!GlobalProgramInfo.link()) {
     errs() << "Linking failed!\n";
@@ -543,9 +759,9 @@ bool _3CInterface::buildInitialConstraints() {
   // 2. Gather constraints.
   ConstraintBuilderConsumer CB =
       ConstraintBuilderConsumer(GlobalProgramInfo, nullptr);
-  for (auto &TU : ASTs)
-    CB.HandleTranslationUnit(TU->getASTContext());
-  if (!isSuccessfulSoFar())
+  if (!forEachTranslationUnit(
+          [&CB](ASTContext &C) { CB.HandleTranslationUnit(C); }) ||
+      !isSuccessfulSoFar())
     return false;
 
   ConstraintsBuilt = true;
@@ -555,6 +771,7 @@ bool _3CInterface::buildInitialConstraints() {
 
 bool _3CInterface::solveConstraints() {
   std::lock_guard<std::mutex> Lock(InterfaceMutex);
+  TimeTraceScope TraceScope("3C solve constraints");
   assert(ConstraintsBuilt && "Constraints not yet built. We need to call "
                              "build constraint before trying to solve them.");
   // 3. Solve constraints.
@@ -573,7 +790,8 @@ bool _3CInterface::solveConstraints() {
   if (_3COpts.Verbose)
     errs() << "Constraints solved\n";
 
-  if (_3COpts.WarnRootCause)
+  // The server reports the root causes of WILD pointers to its clients.
+  if (_3COpts.WarnRootCause || _3COpts.Server)
     GlobalProgramInfo.computeInterimConstraintState(FilePaths);
 
   if (_3COpts.DumpIntermediate)
@@ -597,9 +815,9 @@ bool _3CInterface::solveConstraints() {
     // 4. Infer the bounds based on calls to malloc and calloc
     AllocBasedBoundsInference ABBI =
         AllocBasedBoundsInference(GlobalProgramInfo, nullptr);
-    for (auto &TU : ASTs)
-      ABBI.HandleTranslationUnit(TU->getASTContext());
-    if (!isSuccessfulSoFar())
+    if (!forEachTranslationUnit(
+            [&ABBI](ASTContext &C) { ABBI.HandleTranslationUnit(C); }) ||
+        !isSuccessfulSoFar())
       return false;
 
     // Propagate the information from allocator bounds.
@@ -609,9 +827,9 @@ bool _3CInterface::solveConstraints() {
   // 5. Run intermediate tool hook to run visitors that need to be executed
   // after constraint solving but before rewriting.
   IntermediateToolHook ITH = IntermediateToolHook(GlobalProgramInfo, nullptr);
-  for (auto &TU : ASTs)
-    ITH.HandleTranslationUnit(TU->getASTContext());
-  if (!isSuccessfulSoFar())
+  if (!forEachTranslationUnit(
+          [&ITH](ASTContext &C) { ITH.HandleTranslationUnit(C); }) ||
+      !isSuccessfulSoFar())
     return false;
 
   if (_3COpts.AllTypes) {
@@ -658,17 +876,47 @@ bool _3CInterface::solveConstraints() {
 
 bool _3CInterface::writeAllConvertedFilesToDisk() {
   std::lock_guard<std::mutex> Lock(InterfaceMutex);
+  TimeTraceScope TraceScope("3C rewrite");
 
   // 6. Rewrite the input files.
   RewriteConsumer RC = RewriteConsumer(GlobalProgramInfo);
-  for (auto &TU : ASTs)
-    RC.HandleTranslationUnit(TU->getASTContext());
+  // Write each file once the last translation unit that includes it has been
+  // rewritten, so only the files still shared with later translation units
+  // are held in memory. In bounded-memory mode, if a translation unit cannot
+  // be re-parsed, the files finished before it have already been written.
+  llvm::StringMap<unsigned> LastIncludedBy;
+  for (unsigned Idx = 0; Idx < TUFiles.size(); Idx++)
+    for (const auto &File : TUFiles[Idx].Files)
+      LastIncludedBy[File.getKey()] = Idx;
+  unsigned Idx = 0;
+  if (!forEachTranslationUnit([&](ASTContext &C) {
+        RC.HandleTranslationUnit(C);
+        RC.writeFinishedFiles(C, [&](StringRef File) {
+          auto It = LastIncludedBy.find(File);
+          return It == LastIncludedBy.end() || It->second == Idx;
+        });
+        Idx++;
+      }))
+    return false;
 
   GlobalProgramInfo.getPerfStats().endTotalTime();
   GlobalProgramInfo.getPerfStats().startTotalTime();
   return isSuccessfulSoFar();
 }
 
+bool _3CInterface::getAllConvertedFiles(
+    std::map<std::string, RewrittenFile> &Files) {
+  std::lock_guard<std::mutex> Lock(InterfaceMutex);
+  TimeTraceScope TraceScope("3C rewrite");
+
+  RewriteConsumer RC = RewriteConsumer(GlobalProgramInfo);
+  if (!forEachTranslationUnit(
+          [&RC](ASTContext &C) { RC.HandleTranslationUnit(C); }))
+    return false;
+  Files = RC.takeChangedFiles();
+  return isSuccessfulSoFar();
+}
+
 bool _3CInterface::dumpStats() {
   if (_3COpts.AllTypes && DebugArrSolver) {
     GlobalProgramInfo.getABoundsInfo().dumpAVarGraph("arr_bounds_final.dot");
@@ -703,6 +951,14 @@ bool _3CInterface::dumpStats() {
       PerWildPtrInfo.close();
     }
   }
+
+  if (!_3COpts.TimeTraceFile.empty() && timeTraceProfilerEnabled()) {
+    if (Error E = timeTraceProfilerWrite(_3COpts.TimeTraceFile, "3c")) {
+      errs() << "3C error: Failed to write time trace: "
+             << toString(std::move(E)) << "\n";
+      HadNonDiagnosticError = true;
+    }
+  }
   return isSuccessfulSoFar();
 }
 
@@ -710,16 +966,85 @@ ConstraintsInfo &_3CInterface::getWildPtrsInfo() {
   return GlobalProgramInfo.getInterimConstraintState();
 }
 
+bool _3CInterface::makeSinglePtrNonWild(ConstraintKey TargetPtr) {
+  std::lock_guard<std::mutex> Lock(InterfaceMutex);
+  Constraints &CS = GlobalProgramInfo.getConstraints();
+
+  // Delete the constraint that makes the provided pointer WILD.
+  VarAtom *VA = CS.getVar(TargetPtr);
+  Geq *WildConstraint = VA ? CS.getGeq(VA, CS.getWild()) : nullptr;
+  if (WildConstraint == nullptr)
+    return false;
+  CS.removeConstraint(WildConstraint);
+  VA->getAllConstraints().erase(WildConstraint);
+
+  Constraints::ConstraintSet Removed;
+  Removed.insert(WildConstraint);
+  resolveAfterRemoval(Removed);
+  return true;
+}
+
+bool _3CInterface::invalidateWildReasonGlobally(ConstraintKey PtrKey) {
+  std::lock_guard<std::mutex> Lock(InterfaceMutex);
+  Constraints &CS = GlobalProgramInfo.getConstraints();
+
+  VarAtom *VA = CS.getVar(PtrKey);
+  Geq *WildConstraint = VA ? CS.getGeq(VA, CS.getWild()) : nullptr;
+  if (WildConstraint == nullptr)
+    return false;
+
+  Constraints::ConstraintSet Removed;
+  invalidateAllConstraintsWithReason(WildConstraint, Removed);
+  resolveAfterRemoval(Removed);
+  return true;
+}
+
+void _3CInterface::resolveAfterRemoval(
+    const Constraints::ConstraintSet &Removed) {
+  Constraints &CS = GlobalProgramInfo.getConstraints();
+  auto &PStats = GlobalProgramInfo.getPerfStats();
+
+  PStats.startConstraintSolverTime();
+  bool Incremental = CS.solveAfterRemoval(Removed);
+  if (!Incremental) {
+    CS.resetEnvironment();
+    runSolver(GlobalProgramInfo, FilePaths);
+  }
+  PStats.endConstraintSolverTime();
+  if (_3COpts.Verbose)
+    errs() << (Incremental ? "Updated the solution incrementally\n"
+                           : "Solved the constraints again\n");
+
+  // Only the atoms that were directly WILD because of a removed constraint
+  // lose their root causes, unless a removed constraint between two atoms
+  // changed which atoms the remaining roots reach.
+  std::set<VarAtom *> FormerRoots;
+  for (Constraint *C : Removed) {
+    auto *G = cast<Geq>(C);
+    auto *VA = dyn_cast<VarAtom>(G->getLHS());
+    if (VA == nullptr || !isa<WildAtom>(G->getRHS()))
+      Incremental = false;
+    else
+      FormerRoots.insert(VA);
+  }
+  if (!Incremental) {
+    GlobalProgramInfo.computeInterimConstraintState(FilePaths);
+    return;
+  }
+  GlobalProgramInfo.removeWildRootsFromInterimState(FormerRoots);
+}
+
 void _3CInterface::invalidateAllConstraintsWithReason(
-    Constraint *ConstraintToRemove) {
+    Constraint *ConstraintToRemove,
+    Constraints::ConstraintSet &ToRemoveConstraints) {
   // Get the reason for the current constraint.
   std::string ConstraintRsn = ConstraintToRemove->getReasonText();
-  Constraints::ConstraintSet ToRemoveConstraints;
   Constraints &CS = GlobalProgramInfo.getConstraints();
   // Remove all constraints that have the reason.
   CS.removeAllConstraintsOnReason(ConstraintRsn, ToRemoveConstraints);
 
-  // Free up memory by deleting all the removed constraints.
+  // Detach the removed constraints from their atoms. Their memory is owned
+  // by the constraint system and released together with it.
   for (auto *ToDelCons : ToRemoveConstraints) {
     assert(dyn_cast<Geq>(ToDelCons) && "We can only delete Geq constraints.");
     Geq *TCons = dyn_cast<Geq>(ToDelCons);
@@ -727,6 +1052,5 @@ void _3CInterface::invalidateAllConstraintsWithReason(
     assert(Vatom != nullptr && "Equality constraint with out VarAtom as LHS");
     VarAtom *VS = CS.getOrCreateVar(Vatom->getLoc(), "q", VarAtom::V_Other);
     VS->getAllConstraints().erase(TCons);
-    delete (ToDelCons);
   }
 }
@@ -0,0 +1,373 @@
+//=--3CServer.cpp-------------------------------------------------*- C++-*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Implementation of the 3C server (-server).
+//
+// The constraints of a translation unit are merged with those of the other
+// translation units as soon as they are generated (declarations are linked
+// across translation units, and atoms, bounds keys and root causes are shared),
+// so they cannot be retracted one translation unit at a time. Instead, after
+// an edit the server builds a new _3CInterface that takes over the ASTs of the
+// translation units that did not read an edited file and re-parses only the
+// others, then generates and solves the constraints again. Parsing dominates
+// the running time of 3C on most programs, so this is what keeping the
+// program warm saves.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/3C/3CServer.h"
+#include "clang/3C/3C.h"
+#include "clang/3C/3CGlobalOptions.h"
+#include "clang/3C/RewriteUtils.h"
+#include "clang/3C/Utils.h"
+#include "llvm/Support/JSON.h"
+
+using namespace clang;
+using namespace llvm;
+
+namespace {
+
+// Error codes defined by JSON-RPC 2.0.
+enum RPCErrorCode {
+  ParseError = -32700,
+  InvalidRequest = -32600,
+  MethodNotFound = -32601,
+  InvalidParams = -32602,
+  InternalError = -32603,
+};
+
+// See clang/docs/checkedc/3C/clang-tidy.md#_3c-name-prefix
+// NOLINTNEXTLINE(readability-identifier-naming)
+class _3CServer {
+public:
+  _3CServer(const struct _3COptions &CCopt,
+            const std::vector<std::string> &SourceFileList,
+            tooling::CompilationDatabase *CompDB)
+      : Options(CCopt), SourceFileList(SourceFileList), CompDB(CompDB) {}
+
+  int run(std::FILE *In, raw_ostream &Out);
+
+private:
+  const struct _3COptions Options;
+  const std::vector<std::string> SourceFileList;
+  tooling::CompilationDatabase *CompDB;
+
+  // Null until the "initialize" request.
+  std::unique_ptr<_3CInterface> Interface;
+  // Whether the constraints of Interface are solved, so that its rewrites and
+  // WILD pointers can be queried.
+  bool Converted = false;
+  // The new versions of the files as last reported to the client, keyed by
+  // output path.
+  std::map<std::string, RewrittenFile> Reported;
+
+  // The error of the request being handled, if any.
+  int ErrorCode = 0;
+  std::string ErrorMessage;
+
+  json::Value handle(StringRef Method, const json::Object &Params,
+                     bool &Shutdown);
+  bool fail(int Code, const Twine &Message);
+
+  // Convert the program with a new _3CInterface, re-parsing only the
+  // translation units that read one of ChangedFiles if there is a previous
+  // one.
+  bool convert(const std::set<std::string> &ChangedFiles);
+  // Rewrite the program and report the files whose new version differs from
+  // the one last reported, along with the WILD roots located in those files
+  // and in AffectedFiles, or all the WILD roots if AllRoots is set.
+  json::Value update(std::set<std::string> AffectedFiles,
+                     bool AllRoots = false);
+
+  json::Object rewriteJson(const std::string &Output,
+                           const RewrittenFile &NewVersion);
+  // The WILD roots located in Files, or all of them if Files is null.
+  json::Array wildRoots(const std::set<std::string> *Files);
+  // Read the "files" parameter as canonical paths. Returns false if it is
+  // malformed, or if it is missing and Required is set.
+  bool getFilesParam(const json::Object &Params, bool Required,
+                     std::set<std::string> &Files);
+};
+
+} // namespace
+
+// Read a line from In without its line terminator. Returns false at the end of
+// the input.
+static bool readLine(std::FILE *In, std::string &Line) {
+  Line.clear();
+  char Buf[4096];
+  while (std::fgets(Buf, sizeof(Buf), In)) {
+    Line += Buf;
+    if (Line.back() == '\n') {
+      Line.pop_back();
+      if (!Line.empty() && Line.back() == '\r')
+        Line.pop_back();
+      return true;
+    }
+  }
+  return !Line.empty();
+}
+
+bool _3CServer::fail(int Code, const Twine &Message) {
+  ErrorCode = Code;
+  ErrorMessage = Message.str();
+  return false;
+}
+
+int _3CServer::run(std::FILE *In, raw_ostream &Out) {
+  std::string Line;
+  bool Shutdown = false;
+  while (!Shutdown && readLine(In, Line)) {
+    if (StringRef(Line).trim().empty())
+      continue;
+    ErrorCode = 0;
+    json::Value Id = nullptr;
+    json::Value Result = nullptr;
+    bool IsNotification = false;
+
+    Expected<json::Value> Request = json::parse(Line);
+    const json::Object *Obj = nullptr;
+    if (!Request) {
+      fail(ParseError, toString(Request.takeError()));
+    } else if (!(Obj = Request->getAsObject())) {
+      fail(InvalidRequest, "the request is not an object");
+    } else {
+      if (const json::Value *RequestId = Obj->get("id"))
+        Id = *RequestId;
+      else
+        IsNotification = true;
+      Optional<StringRef> Method = Obj->getString("method");
+      const json::Value *Params = Obj->get("params");
+      static const json::Object NoParams;
+      if (!Method)
+        fail(InvalidRequest, "the request has no method");
+      else if (Params && !Params->getAsObject())
+        fail(InvalidParams, "the parameters must be an object");
+      else
+        Result = handle(*Method, Params ? *Params->getAsObject() : NoParams,
+                        Shutdown);
+    }
+
+    if (IsNotification)
+      continue;
+    json::Object Response{{"jsonrpc", "2.0"}, {"id", std::move(Id)}};
+    if (ErrorCode != 0)
+      Response["error"] =
+          json::Object{{"code", ErrorCode}, {"message", ErrorMessage}};
+    else
+      Response["result"] = std::move(Result);
+    Out << json::Value(std::move(Response)) << "\n";
+    Out.flush();
+  }
+  return Interface ? Interface->determineExitCode() : 0;
+}
+
+json::Value _3CServer::handle(StringRef Method, const json::Object &Params,
+                              bool &Shutdown) {
+  if (Method == "shutdown") {
+    Shutdown = true;
+    return nullptr;
+  }
+  if (Method == "initialize") {
+    if (Interface) {
+      fail(InvalidRequest, "the server is already initialized");
+      return nullptr;
+    }
+    if (!convert({}))
+      return nullptr;
+    return update({}, true);
+  }
+
+  if (Method != "fileChanged" && Method != "getRewrites" &&
+      Method != "getWildRoots" && Method != "makeNonWild") {
+    fail(MethodNotFound, "unknown method \"" + Method + "\"");
+    return nullptr;
+  }
+  if (!Interface) {
+    fail(InvalidRequest, "the server is not initialized");
+    return nullptr;
+  }
+
+  if (Method == "fileChanged") {
+    std::set<std::string> Files;
+    if (!getFilesParam(Params, true, Files) || !convert(Files))
+      return nullptr;
+    return update(Files);
+  }
+
+  // The remaining methods need the result of the last conversion.
+  if (!Converted) {
+    fail(InternalError, "the last conversion failed; edit the program to "
+                        "convert it again");
+    return nullptr;
+  }
+
+  if (Method == "getRewrites") {
+    std::set<std::string> Files;
+    if (!getFilesParam(Params, false, Files))
+      return nullptr;
+    json::Array Rewrites;
+    for (auto &Entry : Reported)
+      if (!Params.get("files") || Files.count(Entry.second.SourceFile))
+        Rewrites.push_back(rewriteJson(Entry.first, Entry.second));
+    return std::move(Rewrites);
+  }
+
+  if (Method == "getWildRoots") {
+    std::set<std::string> Files;
+    if (!getFilesParam(Params, false, Files))
+      return nullptr;
+    return wildRoots(Params.get("files") ? &Files : nullptr);
+  }
+
+  assert(Method == "makeNonWild");
+  Optional<int64_t> Key = Params.getInteger("key");
+  if (!Key) {
+    fail(InvalidParams, "missing \"key\" parameter");
+    return nullptr;
+  }
+  // Remember where the roots are, so that the files of the roots that go away
+  // are reported as affected.
+  ConstraintsInfo &Info = Interface->getWildPtrsInfo();
+  std::map<ConstraintKey, std::string> RootFiles;
+  for (auto &Entry : Info.RootWildAtomsWithReason)
+    RootFiles[Entry.first] = Entry.second.getLocation().getFileName();
+  bool Removed = Params.getBoolean("global").getValueOr(false)
+                     ? Interface->invalidateWildReasonGlobally(*Key)
+                     : Interface->makeSinglePtrNonWild(*Key);
+  if (!Removed) {
+    fail(InvalidParams, "atom " + Twine(*Key) + " is not directly WILD");
+    return nullptr;
+  }
+  std::set<std::string> Affected;
+  for (auto &Entry : RootFiles)
+    if (!Info.RootWildAtomsWithReason.count(Entry.first))
+      Affected.insert(Entry.second);
+  return update(Affected);
+}
+
+bool _3CServer::convert(const std::set<std::string> &ChangedFiles) {
+  std::unique_ptr<_3CInterface> Next =
+      _3CInterface::create(Options, SourceFileList, CompDB);
+  if (!Next)
+    return fail(InternalError, "failed to initialize 3C; see stderr");
+  bool Parsed =
+      Interface ? Next->parseASTs(*Interface, ChangedFiles) : Next->parseASTs();
+  if (Interface) {
+    // This finishes the diagnostics of the ASTs that were not taken over.
+    Interface->determineExitCode();
+  }
+  Interface = std::move(Next);
+  // TODO: Each edit still costs a full constraint generation and solve of the
+  // whole program. To make it proportional to the edit, tag each Geq with the
+  // translation unit that added it, retract the constraints of the re-parsed
+  // translation units and re-solve from the remaining ones as
+  // Constraints::solveAfterRemoval does for makeNonWild. This needs the
+  // declarations, bounds keys and root causes that are merged across
+  // translation units to be split per translation unit first.
+  Converted = Parsed && Interface->addVariables() &&
+              Interface->buildInitialConstraints() &&
+              Interface->solveConstraints();
+  if (!Converted)
+    return fail(InternalError, "failed to convert the program; see stderr");
+  return true;
+}
+
+json::Value _3CServer::update(std::set<std::string> AffectedFiles,
+                              bool AllRoots) {
+  std::map<std::string, RewrittenFile> Files;
+  if (!Interface->getAllConvertedFiles(Files)) {
+    fail(InternalError, "failed to rewrite the program; see stderr");
+    return nullptr;
+  }
+
+  json::Array Rewrites;
+  for (auto &Entry : Files) {
+    auto It = Reported.find(Entry.first);
+    if (It != Reported.end() &&
+        It->second.NewContents == Entry.second.NewContents)
+      continue;
+    Rewrites.push_back(rewriteJson(Entry.first, Entry.second));
+    AffectedFiles.insert(Entry.second.SourceFile);
+  }
+  // Files that no longer need any change.
+  for (auto &Entry : Reported) {
+    if (Files.count(Entry.first))
+      continue;
+    json::Object Rewrite = rewriteJson(Entry.first, Entry.second);
+    Rewrite["contents"] = nullptr;
+    Rewrites.push_back(std::move(Rewrite));
+    AffectedFiles.insert(Entry.second.SourceFile);
+  }
+  Reported = std::move(Files);
+
+  return json::Object{
+      {"rewrites", std::move(Rewrites)},
+      {"wildRoots", wildRoots(AllRoots ? nullptr : &AffectedFiles)}};
+}
+
+json::Object _3CServer::rewriteJson(const std::string &Output,
+                                    const RewrittenFile &NewVersion) {
+  return json::Object{{"file", NewVersion.SourceFile},
+                      {"output", Output},
+                      {"contents", NewVersion.NewContents}};
+}
+
+json::Array _3CServer::wildRoots(const std::set<std::string> *Files) {
+  ConstraintsInfo &Info = Interface->getWildPtrsInfo();
+  json::Array Roots;
+  for (auto &Entry : Info.RootWildAtomsWithReason) {
+    const PersistentSourceLoc &PSL = Entry.second.getLocation();
+    if (Files && !Files->count(PSL.getFileName()))
+      continue;
+    json::Object Root{{"key", Entry.first},
+                      {"reason", Entry.second.getReason()},
+                      {"affectedPointers",
+                       Info.getNumPtrsAffected(Entry.first)}};
+    if (PSL.valid()) {
+      Root["file"] = PSL.getFileName();
+      Root["line"] = PSL.getLineNo();
+      Root["column"] = PSL.getColSNo();
+    }
+    Roots.push_back(std::move(Root));
+  }
+  return Roots;
+}
+
+bool _3CServer::getFilesParam(const json::Object &Params, bool Required,
+                              std::set<std::string> &Files) {
+  const json::Value *Value = Params.get("files");
+  if (!Value) {
+    if (Required)
+      return fail(InvalidParams, "missing \"files\" parameter");
+    return true;
+  }
+  const json::Array *List = Value->getAsArray();
+  if (!List)
+    return fail(InvalidParams, "\"files\" must be a list of paths");
+  for (const json::Value &Item : *List) {
+    Optional<StringRef> Path = Item.getAsString();
+    if (!Path)
+      return fail(InvalidParams, "\"files\" must be a list of paths");
+    // A deleted file cannot be canonicalized, but the translation units that
+    // read it know it by its canonical path, which the client should use.
+    std::string Canonical;
+    if (tryGetCanonicalFilePath(Path->str(), Canonical))
+      Canonical = Path->str();
+    Files.insert(Canonical);
+  }
+  return true;
+}
+
+int run3CServer(const struct _3COptions &CCopt,
+                const std::vector<std::string> &SourceFileList,
+                tooling::CompilationDatabase *CompDB, std::FILE *In,
+                raw_ostream &Out) {
+  _3CServer Server(CCopt, SourceFileList, CompDB);
+  return Server.run(In, Out);
+}
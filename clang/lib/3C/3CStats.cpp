@@ -11,48 +11,107 @@
 #include "clang/3C/3CStats.h"
 #include "clang/3C/ProgramInfo.h"
 #include "clang/3C/Utils.h"
-#include <time.h>
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/Process.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
 
-void PerformanceStats::startCompileTime() { CompileTimeSt = clock(); }
+// Peak resident set size of the process in bytes, or 0 if unknown.
+static uint64_t getPeakRSS() {
+#if defined(__unix__) || defined(__APPLE__)
+  struct rusage RU;
+  if (::getrusage(RUSAGE_SELF, &RU) != 0)
+    return 0;
+#ifdef __APPLE__
+  return RU.ru_maxrss;
+#else
+  // Linux and the BSDs report kilobytes.
+  return uint64_t(RU.ru_maxrss) * 1024;
+#endif
+#else
+  return 0;
+#endif
+}
+
+static double getProcessTime() {
+  llvm::sys::TimePoint<> Elapsed;
+  std::chrono::nanoseconds User, Sys;
+  llvm::sys::Process::GetTimeUsage(Elapsed, User, Sys);
+  return std::chrono::duration<double>(User + Sys).count();
+}
+
+void PerformanceStats::startPhase(PhaseStart &St) {
+  St.MallocBytes = llvm::sys::Process::GetMallocUsage();
+  St.CPUTime = getProcessTime();
+  St.WallTime = std::chrono::steady_clock::now();
+}
 
-void PerformanceStats::endCompileTime() {
-  CompileTime += getTimeSpentInSeconds(CompileTimeSt);
+void PerformanceStats::endPhase(PhaseStats &Stats, const PhaseStart &St) {
+  Stats.WallTime += std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - St.WallTime)
+                        .count();
+  Stats.CPUTime += getProcessTime() - St.CPUTime;
+  Stats.MallocBytes +=
+      int64_t(llvm::sys::Process::GetMallocUsage()) - int64_t(St.MallocBytes);
+  Stats.PeakRSS = getPeakRSS();
+  Stats.Intervals++;
+}
+
+void PerformanceStats::startCompileTime() { startPhase(CompileTimeSt); }
+
+void PerformanceStats::endCompileTime() { endPhase(Compile, CompileTimeSt); }
+
+void PerformanceStats::startVariableAdderTime() {
+  startPhase(VariableAdderTimeSt);
+}
+
+void PerformanceStats::endVariableAdderTime() {
+  endPhase(VariableAdder, VariableAdderTimeSt);
 }
 
 void PerformanceStats::startConstraintBuilderTime() {
-  ConstraintBuilderTimeSt = clock();
+  startPhase(ConstraintBuilderTimeSt);
 }
 
 void PerformanceStats::endConstraintBuilderTime() {
-  ConstraintBuilderTime += getTimeSpentInSeconds(ConstraintBuilderTimeSt);
+  endPhase(ConstraintBuilder, ConstraintBuilderTimeSt);
 }
 
 void PerformanceStats::startConstraintSolverTime() {
-  ConstraintSolverTimeSt = clock();
+  startPhase(ConstraintSolverTimeSt);
 }
 
 void PerformanceStats::endConstraintSolverTime() {
-  ConstraintSolverTime += getTimeSpentInSeconds(ConstraintSolverTimeSt);
+  endPhase(ConstraintSolver, ConstraintSolverTimeSt);
 }
 
 void PerformanceStats::startArrayBoundsInferenceTime() {
-  ArrayBoundsInferenceTimeSt = clock();
+  startPhase(ArrayBoundsInferenceTimeSt);
 }
 
 void PerformanceStats::endArrayBoundsInferenceTime() {
-  ArrayBoundsInferenceTime += getTimeSpentInSeconds(ArrayBoundsInferenceTimeSt);
+  endPhase(ArrayBoundsInference, ArrayBoundsInferenceTimeSt);
 }
 
-void PerformanceStats::startRewritingTime() { RewritingTimeSt = clock(); }
+void PerformanceStats::startRewritingTime() { startPhase(RewritingTimeSt); }
 
 void PerformanceStats::endRewritingTime() {
-  RewritingTime += getTimeSpentInSeconds(RewritingTimeSt);
+  endPhase(Rewriting, RewritingTimeSt);
 }
 
-void PerformanceStats::startTotalTime() { TotalTimeSt = clock(); }
+void PerformanceStats::startTotalTime() { startPhase(TotalTimeSt); }
+
+void PerformanceStats::endTotalTime() { endPhase(Total, TotalTimeSt); }
 
-void PerformanceStats::endTotalTime() {
-  TotalTime += getTimeSpentInSeconds(TotalTimeSt);
+PerformanceStats::TUTimes &PerformanceStats::getTUTimes(ASTContext &C) {
+  return PerTUTimes[getTUName(C)];
+}
+
+std::string PerformanceStats::getTUName(ASTContext &C) {
+  SourceManager &SM = C.getSourceManager();
+  const FileEntry *FE = SM.getFileEntryForID(SM.getMainFileID());
+  return FE != nullptr ? FE->getName().str() : "";
 }
 
 void PerformanceStats::incrementNumAssumeBounds() { NumAssumeBoundsCasts++; }
@@ -68,36 +127,116 @@ void PerformanceStats::incrementNumCheckedRegions() { NumCheckedRegions++; }
 
 void PerformanceStats::incrementNumUnCheckedRegions() { NumUnCheckedRegions++; }
 
+std::vector<std::pair<const char *, const PhaseStats *>>
+PerformanceStats::getPhases() const {
+  return {{"Total", &Total},
+          {"Compile", &Compile},
+          {"VariableAdder", &VariableAdder},
+          {"ConstraintBuilder", &ConstraintBuilder},
+          {"ConstraintSolver", &ConstraintSolver},
+          {"ArrayBoundsInference", &ArrayBoundsInference},
+          {"Rewriting", &Rewriting}};
+}
+
+void PerformanceStats::printPerformanceStats(llvm::json::OStream &J) {
+  auto Section = [&J](llvm::StringRef Name, llvm::function_ref<void()> Fn) {
+    J.object([&] { J.attributeObject(Name, Fn); });
+  };
+  J.array([&] {
+    Section("TimeStats", [&] {
+      J.attribute("TotalTime", Total.WallTime);
+      J.attribute("CompileTime", Compile.WallTime);
+      J.attribute("VariableAdderTime", VariableAdder.WallTime);
+      J.attribute("ConstraintBuilderTime", ConstraintBuilder.WallTime);
+      J.attribute("ConstraintSolverTime", ConstraintSolver.WallTime);
+      J.attribute("ArrayBoundsInferenceTime", ArrayBoundsInference.WallTime);
+      J.attribute("RewritingTime", Rewriting.WallTime);
+    });
+
+    Section("PhaseStats", [&] {
+      for (const auto &P : getPhases())
+        J.attributeObject(P.first, [&] {
+          J.attribute("WallTime", P.second->WallTime);
+          J.attribute("CPUTime", P.second->CPUTime);
+          J.attribute("MallocBytes", P.second->MallocBytes);
+          J.attribute("PeakRSS", int64_t(P.second->PeakRSS));
+          J.attribute("Intervals", int64_t(P.second->Intervals));
+        });
+    });
+
+    J.object([&] {
+      J.attributeArray("TranslationUnitStats", [&] {
+        for (const auto &TU : PerTUTimes)
+          J.object([&] {
+            J.attribute("File", TU.first);
+            J.attribute("VariableAdderTime", TU.second.VariableAdderTime);
+            J.attribute("ConstraintBuilderTime",
+                        TU.second.ConstraintBuilderTime);
+            J.attribute("RewritingTime", TU.second.RewritingTime);
+          });
+      });
+    });
+
+    Section("ReWriteStats", [&] {
+      J.attribute("NumAssumeBoundsCasts", int64_t(NumAssumeBoundsCasts));
+      J.attribute("NumCheckedCasts", int64_t(NumCheckedCasts));
+      J.attribute("NumWildCasts", int64_t(NumWildCasts));
+      J.attribute("NumFixedCasts", int64_t(NumFixedCasts));
+      J.attribute("NumITypes", int64_t(NumITypes));
+      J.attribute("NumCheckedRegions", int64_t(NumCheckedRegions));
+      J.attribute("NumUnCheckedRegions", int64_t(NumUnCheckedRegions));
+    });
+
+    Section("ReachabilityCacheStats", [&] {
+      J.attribute("CachedNodes", int64_t(ReachabilityCacheNodes));
+      J.attribute("Evictions", int64_t(ReachabilityCacheEvictions));
+    });
+
+    Section("ArrayBoundsInferenceStats", [&] {
+      J.attribute("Runs", int64_t(ArrayBoundsRuns));
+      J.attribute("Rounds", int64_t(ArrayBoundsRounds));
+      J.attribute("RoundsSkipped", int64_t(ArrayBoundsRoundsSkipped));
+      J.attribute("KeysVisited", int64_t(ArrayBoundsKeysVisited));
+      J.attribute("KeysInferred", int64_t(ArrayBoundsKeysInferred));
+    });
+
+    Section("ContextSensitiveBoundsStats", [&] {
+      J.attribute("Contexts", int64_t(CtxSensContexts));
+      J.attribute("MergedContexts", int64_t(CtxSensContextsMerged));
+      J.attribute("CappedContexts", int64_t(CtxSensContextsCapped));
+      J.attribute("Keys", int64_t(CtxSensKeys));
+    });
+  });
+}
+
 void PerformanceStats::printPerformanceStats(llvm::raw_ostream &O,
                                              bool JsonFormat) {
   if (JsonFormat) {
-    O << "[";
-
-    O << "{\"TimeStats\": {\"TotalTime\":" << TotalTime;
-    O << ", \"ConstraintBuilderTime\":" << ConstraintBuilderTime;
-    O << ", \"ConstraintSolverTime\":" << ConstraintSolverTime;
-    O << ", \"ArrayBoundsInferenceTime\":" << ArrayBoundsInferenceTime;
-    O << ", \"RewritingTime\":" << RewritingTime;
-    O << "}},\n";
-
-    O << "{\"ReWriteStats\":{";
-    O << "\"NumAssumeBoundsCasts\":" << NumAssumeBoundsCasts;
-    O << ", \"NumCheckedCasts\":" << NumCheckedCasts;
-    O << ", \"NumWildCasts\":" << NumWildCasts;
-    O << ", \"NumFixedCasts\":" << NumFixedCasts;
-    O << ", \"NumITypes\":" << NumITypes;
-    O << ", \"NumCheckedRegions\":" << NumCheckedRegions;
-    O << ", \"NumUnCheckedRegions\":" << NumUnCheckedRegions;
-    O << "}}";
-
-    O << "]";
+    llvm::json::OStream J(O);
+    printPerformanceStats(J);
   } else {
     O << "TimeStats\n";
-    O << "TotalTime:" << TotalTime << "\n";
-    O << "ConstraintBuilderTime:" << ConstraintBuilderTime << "\n";
-    O << "ConstraintSolverTime:" << ConstraintSolverTime << "\n";
-    O << "ArrayBoundsInferenceTime:" << ArrayBoundsInferenceTime << "\n";
-    O << "RewritingTime:" << RewritingTime << "\n";
+    O << "TotalTime:" << Total.WallTime << "\n";
+    O << "CompileTime:" << Compile.WallTime << "\n";
+    O << "VariableAdderTime:" << VariableAdder.WallTime << "\n";
+    O << "ConstraintBuilderTime:" << ConstraintBuilder.WallTime << "\n";
+    O << "ConstraintSolverTime:" << ConstraintSolver.WallTime << "\n";
+    O << "ArrayBoundsInferenceTime:" << ArrayBoundsInference.WallTime << "\n";
+    O << "RewritingTime:" << Rewriting.WallTime << "\n";
+
+    O << "PhaseStats\n";
+    for (const auto &P : getPhases())
+      O << P.first << ":WallTime=" << P.second->WallTime
+        << ",CPUTime=" << P.second->CPUTime
+        << ",MallocBytes=" << P.second->MallocBytes
+        << ",PeakRSS=" << P.second->PeakRSS
+        << ",Intervals=" << P.second->Intervals << "\n";
+
+    O << "TranslationUnitStats\n";
+    for (const auto &TU : PerTUTimes)
+      O << TU.first << ":VariableAdderTime=" << TU.second.VariableAdderTime
+        << ",ConstraintBuilderTime=" << TU.second.ConstraintBuilderTime
+        << ",RewritingTime=" << TU.second.RewritingTime << "\n";
 
     O << "ReWriteStats\n";
     O << "NumAssumeBoundsCasts:" << NumAssumeBoundsCasts << "\n";
@@ -107,6 +246,23 @@ void PerformanceStats::printPerformanceStats(llvm::raw_ostream &O,
     O << "NumITypes:" << NumITypes << "\n";
     O << "NumCheckedRegions:" << NumCheckedRegions << "\n";
     O << "NumUnCheckedRegions:" << NumUnCheckedRegions << "\n";
+
+    O << "ReachabilityCacheStats\n";
+    O << "CachedNodes:" << ReachabilityCacheNodes << "\n";
+    O << "Evictions:" << ReachabilityCacheEvictions << "\n";
+
+    O << "ArrayBoundsInferenceStats\n";
+    O << "Runs:" << ArrayBoundsRuns << "\n";
+    O << "Rounds:" << ArrayBoundsRounds << "\n";
+    O << "RoundsSkipped:" << ArrayBoundsRoundsSkipped << "\n";
+    O << "KeysVisited:" << ArrayBoundsKeysVisited << "\n";
+    O << "KeysInferred:" << ArrayBoundsKeysInferred << "\n";
+
+    O << "ContextSensitiveBoundsStats\n";
+    O << "Contexts:" << CtxSensContexts << "\n";
+    O << "MergedContexts:" << CtxSensContextsMerged << "\n";
+    O << "CappedContexts:" << CtxSensContextsCapped << "\n";
+    O << "Keys:" << CtxSensKeys << "\n";
   }
 }
 
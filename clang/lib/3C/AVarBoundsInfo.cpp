@@ -24,45 +24,49 @@ static cl::opt<bool> DisableInfDecls("disable-arr-missd",
                                               "bounds from declarations."),
                                      cl::init(false),
                                      cl::cat(ArrBoundsInferCat));
+static cl::opt<bool> NoIncrementalBounds(
+    "no-incremental-bounds",
+    cl::desc("Infer the bounds of every array pointer that needs them in each "
+             "round of array bounds inference, instead of only those that an "
+             "earlier round's changes can affect."),
+    cl::init(false), cl::Hidden, cl::cat(ArrBoundsInferCat));
 
 void AVarBoundsStats::print(llvm::raw_ostream &O,
-                            const std::set<BoundsKey> *InSrcArrs,
-                            bool JsonFormat) const {
+                            const std::set<BoundsKey> *InSrcArrs) const {
   std::set<BoundsKey> Tmp;
-  if (!JsonFormat) {
-    O << "Array Bounds Inference Stats:\n";
-    findIntersection(NamePrefixMatch, *InSrcArrs, Tmp);
-    O << "NamePrefixMatch:" << Tmp.size() << "\n";
-    findIntersection(AllocatorMatch, *InSrcArrs, Tmp);
-    O << "AllocatorMatch:" << Tmp.size() << "\n";
-    findIntersection(VariableNameMatch, *InSrcArrs, Tmp);
-    O << "VariableNameMatch:" << Tmp.size() << "\n";
-    findIntersection(NeighbourParamMatch, *InSrcArrs, Tmp);
-    O << "NeighbourParamMatch:" << Tmp.size() << "\n";
-    findIntersection(DataflowMatch, *InSrcArrs, Tmp);
-    O << "DataflowMatch:" << Tmp.size() << "\n";
-    findIntersection(DeclaredBounds, *InSrcArrs, Tmp);
-    O << "Declared:" << Tmp.size() << "\n";
-    findIntersection(DeclaredButNotHandled, *InSrcArrs, Tmp);
-    O << "DeclaredButNotHandled:" << Tmp.size() << "\n";
-  } else {
-    O << "\"ArrayBoundsInferenceStats\":{";
-    findIntersection(NamePrefixMatch, *InSrcArrs, Tmp);
-    O << "\"NamePrefixMatch\":" << Tmp.size() << ",\n";
-    findIntersection(AllocatorMatch, *InSrcArrs, Tmp);
-    O << "\"AllocatorMatch\":" << Tmp.size() << ",\n";
-    findIntersection(VariableNameMatch, *InSrcArrs, Tmp);
-    O << "\"VariableNameMatch\":" << Tmp.size() << ",\n";
-    findIntersection(NeighbourParamMatch, *InSrcArrs, Tmp);
-    O << "\"NeighbourParamMatch\":" << Tmp.size() << ",\n";
-    findIntersection(DataflowMatch, *InSrcArrs, Tmp);
-    O << "\"DataflowMatch\":" << Tmp.size() << ",\n";
-    findIntersection(DeclaredBounds, *InSrcArrs, Tmp);
-    O << "\"Declared\":" << Tmp.size() << ",\n";
-    findIntersection(DeclaredButNotHandled, *InSrcArrs, Tmp);
-    O << "\"DeclaredButNotHandled\":" << Tmp.size() << "\n";
-    O << "}";
-  }
+  O << "Array Bounds Inference Stats:\n";
+  findIntersection(NamePrefixMatch, *InSrcArrs, Tmp);
+  O << "NamePrefixMatch:" << Tmp.size() << "\n";
+  findIntersection(AllocatorMatch, *InSrcArrs, Tmp);
+  O << "AllocatorMatch:" << Tmp.size() << "\n";
+  findIntersection(VariableNameMatch, *InSrcArrs, Tmp);
+  O << "VariableNameMatch:" << Tmp.size() << "\n";
+  findIntersection(NeighbourParamMatch, *InSrcArrs, Tmp);
+  O << "NeighbourParamMatch:" << Tmp.size() << "\n";
+  findIntersection(DataflowMatch, *InSrcArrs, Tmp);
+  O << "DataflowMatch:" << Tmp.size() << "\n";
+  findIntersection(DeclaredBounds, *InSrcArrs, Tmp);
+  O << "Declared:" << Tmp.size() << "\n";
+  findIntersection(DeclaredButNotHandled, *InSrcArrs, Tmp);
+  O << "DeclaredButNotHandled:" << Tmp.size() << "\n";
+}
+
+void AVarBoundsStats::print(llvm::json::OStream &J,
+                            const std::set<BoundsKey> *InSrcArrs) const {
+  auto Count = [InSrcArrs](const std::set<BoundsKey> &Keys) {
+    std::set<BoundsKey> Tmp;
+    findIntersection(Keys, *InSrcArrs, Tmp);
+    return int64_t(Tmp.size());
+  };
+  J.attributeObject("ArrayBoundsInferenceStats", [&] {
+    J.attribute("NamePrefixMatch", Count(NamePrefixMatch));
+    J.attribute("AllocatorMatch", Count(AllocatorMatch));
+    J.attribute("VariableNameMatch", Count(VariableNameMatch));
+    J.attribute("NeighbourParamMatch", Count(NeighbourParamMatch));
+    J.attribute("DataflowMatch", Count(DataflowMatch));
+    J.attribute("Declared", Count(DeclaredBounds));
+    J.attribute("DeclaredButNotHandled", Count(DeclaredButNotHandled));
+  });
 }
 
 bool hasArray(const ConstraintVariable *CK, const Constraints &CS) {
@@ -99,15 +103,15 @@ bool isInSrcArray(const ConstraintVariable *CK, const Constraints &CS) {
 class ScopeVisitor {
 public:
   ScopeVisitor(const ProgramVarScope *S,
-               const std::map<BoundsKey, ProgramVar *> &VM,
-               const std::set<BoundsKey> &P)
+               const std::vector<ProgramVar *> &VM,
+               const BoundsKeySet &P)
     : Scope(S), InScopeKeys(), VisibleKeys(), PVarInfo(VM),
       PointerBoundsKey(P) {}
   void visitBoundsKey(BoundsKey V) {
     // If the variable is non-pointer?
-    if (PVarInfo.find(V) != PVarInfo.end() &&
-        PointerBoundsKey.find(V) == PointerBoundsKey.end()) {
-      ProgramVar *S = PVarInfo.at(V);
+    if (V < PVarInfo.size() && PVarInfo[V] != nullptr &&
+        !PointerBoundsKey.count(V)) {
+      ProgramVar *S = PVarInfo[V];
       // If the variable is constant or in the same scope?
       if (S->isNumConstant() || (*Scope == *(S->getScope()))) {
         InScopeKeys.insert(V);
@@ -133,22 +137,21 @@ private:
   // bounds keys from scopes where this scope is an inner scope.
   std::set<BoundsKey> VisibleKeys;
 
-  // A constant reference to PVarInfo frm the AVarBoundsInfo instance. This set
-  // maps each bounds key to variable. BoundsKeys are just a uint_32, so a
-  // corresponding ProgramVar is required find the scope of a key.
-  const std::map<BoundsKey, ProgramVar *> &PVarInfo;
+  // A constant reference to PVarInfo frm the AVarBoundsInfo instance. This
+  // vector maps each bounds key to variable. BoundsKeys are just a uint_32, so
+  // a corresponding ProgramVar is required find the scope of a key.
+  const std::vector<ProgramVar *> &PVarInfo;
 
   // A constant reference to the field PointerBoundsKey from the AVarBoundsInfo
   // instance. This set contains the bounds keys that correspond to pointers.
   // Used to verify that a visited bounds key is not a pointer.
-  const std::set<BoundsKey> &PointerBoundsKey;
+  const BoundsKeySet &PointerBoundsKey;
 };
 
 void AvarBoundsInference::mergeReachableProgramVars(
     BoundsKey TarBK, std::set<BoundsKey> &AllVars) {
   if (AllVars.size() > 1) {
-    bool IsTarNTArr = BI->NtArrPointerBoundsKey.find(TarBK) !=
-                      BI->NtArrPointerBoundsKey.end();
+    bool IsTarNTArr = BI->NtArrPointerBoundsKey.count(TarBK);
     // First, find all variables that are in the SAME scope as TarBK.
     // If there is only one? Then use it.
     if (ProgramVar *TarBVar = BI->getProgramVar(TarBK)) {
@@ -249,6 +252,27 @@ void AvarBoundsInference::convergeInferredBounds() {
   }
 }
 
+void AvarBoundsInference::reuseInferredBounds(const AvarBoundsInference &Saved,
+                                              const BoundsKeySet &Keep) {
+  std::map<BoundsKey, BndsKindMap> InferBounds;
+  for (const auto &KB : Saved.CurrIterInferBounds)
+    if (!Keep.count(KB.first))
+      InferBounds.insert(InferBounds.end(), KB);
+  for (auto &KB : CurrIterInferBounds)
+    if (Keep.count(KB.first))
+      InferBounds.insert(std::move(KB));
+  CurrIterInferBounds = std::move(InferBounds);
+
+  std::set<BoundsKey> FailedFlowInference;
+  for (BoundsKey BK : Saved.BKsFailedFlowInference)
+    if (!Keep.count(BK))
+      FailedFlowInference.insert(FailedFlowInference.end(), BK);
+  for (BoundsKey BK : BKsFailedFlowInference)
+    if (Keep.count(BK))
+      FailedFlowInference.insert(BK);
+  BKsFailedFlowInference = std::move(FailedFlowInference);
+}
+
 // Construct an array bound with the most preferred kind from the bounds kind
 // map. Count bounds have the highest priority, followed by byte count and then
 // count-plus-one bounds. This function assumes that the BoundsKey sets in the
@@ -276,12 +300,12 @@ ABounds *AvarBoundsInference::getPreferredBound(const BndsKindMap &BKindMap) {
 }
 
 bool AvarBoundsInference::hasImpossibleBounds(BoundsKey BK) {
-  return this->BI->PointersWithImpossibleBounds.find(BK) !=
-         this->BI->PointersWithImpossibleBounds.end();
+  return this->BI->PointersWithImpossibleBounds.count(BK);
 }
 
 void AvarBoundsInference::setImpossibleBounds(BoundsKey BK) {
-  this->BI->PointersWithImpossibleBounds.insert(BK);
+  if (this->BI->PointersWithImpossibleBounds.insert(BK))
+    this->BI->markBoundsChanged(BK);
   this->BI->removeBounds(BK);
 }
 
@@ -515,7 +539,7 @@ bool AvarBoundsInference::inferBounds(BoundsKey K, const AVarGraph &BKGraph,
                                       bool FromPB) {
   bool IsChanged = false;
 
-  if (BI->InvalidBounds.find(K) == BI->InvalidBounds.end()) {
+  if (!BI->InvalidBounds.count(K)) {
     // Infer from potential bounds?
     if (FromPB) {
       IsChanged = inferFromPotentialBounds(K, BKGraph);
@@ -569,7 +593,8 @@ bool AvarBoundsInference::inferFromPotentialBounds(BoundsKey BK,
 }
 
 bool PotentialBoundsInfo::hasPotentialCountBounds(BoundsKey PtrBK) {
-  return PotentialCntBounds.find(PtrBK) != PotentialCntBounds.end();
+  return PtrBK < PotentialCntBounds.size() &&
+         !PotentialCntBounds[PtrBK].empty();
 }
 
 std::set<BoundsKey> &PotentialBoundsInfo::getPotentialBounds(BoundsKey PtrBK) {
@@ -580,13 +605,16 @@ std::set<BoundsKey> &PotentialBoundsInfo::getPotentialBounds(BoundsKey PtrBK) {
 void PotentialBoundsInfo::addPotentialBounds(BoundsKey BK,
                                              const std::set<BoundsKey> &PotK) {
   if (!PotK.empty()) {
+    if (BK >= PotentialCntBounds.size())
+      PotentialCntBounds.resize(BK + 1);
     auto &TmpK = PotentialCntBounds[BK];
     TmpK.insert(PotK.begin(), PotK.end());
   }
 }
 
 bool PotentialBoundsInfo::hasPotentialCountPOneBounds(BoundsKey PtrBK) {
-  return PotentialCntPOneBounds.find(PtrBK) != PotentialCntPOneBounds.end();
+  return PtrBK < PotentialCntPOneBounds.size() &&
+         !PotentialCntPOneBounds[PtrBK].empty();
 }
 
 std::set<BoundsKey> &
@@ -598,6 +626,8 @@ PotentialBoundsInfo::getPotentialBoundsPOne(BoundsKey PtrBK) {
 void PotentialBoundsInfo::addPotentialBoundsPOne(
     BoundsKey BK, const std::set<BoundsKey> &PotK) {
   if (!PotK.empty()) {
+    if (BK >= PotentialCntPOneBounds.size())
+      PotentialCntPOneBounds.resize(BK + 1);
     auto &TmpK = PotentialCntPOneBounds[BK];
     TmpK.insert(PotK.begin(), PotK.end());
   }
@@ -644,11 +674,13 @@ void AVarBoundsInfo::insertDeclaredBounds(BoundsKey BK, ABounds *B) {
   if (B != nullptr) {
     // If there is already bounds information, release it.
     removeBounds(BK);
-    BInfo[BK][Declared] = B;
+    getBoundsInfo(BK)[Declared] = B;
+    markBoundsChanged(BK);
     BoundsInferStats.DeclaredBounds.insert(BK);
   } else {
     // Set bounds to be invalid.
-    InvalidBounds.insert(BK);
+    if (InvalidBounds.insert(BK))
+      markBoundsChanged(BK);
     BoundsInferStats.DeclaredButNotHandled.insert(BK);
   }
 }
@@ -711,15 +743,18 @@ bool AVarBoundsInfo::tryGetVariable(clang::Expr *E, const ASTContext &C,
 // Returns true if we update the bounds for L (with B)
 bool AVarBoundsInfo::mergeBounds(BoundsKey L, BoundsPriority P, ABounds *B) {
   bool RetVal = false;
-  if (BInfo.find(L) != BInfo.end() && BInfo[L].find(P) != BInfo[L].end()) {
+  auto &PriBInfo = getBoundsInfo(L);
+  if (PriBInfo.find(P) != PriBInfo.end()) {
     // If previous computed bounds are not same? Then release the old bounds.
-    if (!BInfo[L][P]->areSame(B, this)) {
-      InvalidBounds.insert(L);
+    if (!PriBInfo[P]->areSame(B, this)) {
+      if (InvalidBounds.insert(L))
+        markBoundsChanged(L);
       // TODO: Should we keep bounds for other priorities?
       removeBounds(L);
     }
   } else {
-    BInfo[L][P] = B;
+    PriBInfo[P] = B;
+    markBoundsChanged(L);
     RetVal = true;
   }
   return RetVal;
@@ -727,27 +762,27 @@ bool AVarBoundsInfo::mergeBounds(BoundsKey L, BoundsPriority P, ABounds *B) {
 
 bool AVarBoundsInfo::removeBounds(BoundsKey L, BoundsPriority P) {
   bool RetVal = false;
-  if (BInfo.find(L) != BInfo.end()) {
+  if (hasBoundsInfo(L)) {
     auto &PriBInfo = BInfo[L];
     if (P == Invalid) {
       // Delete bounds for all priorities.
       for (auto &T : PriBInfo) {
         delete (T.second);
       }
-      BInfo.erase(L);
+      PriBInfo.clear();
+      markBoundsChanged(L);
       RetVal = true;
     } else {
       // Delete bounds for only the given priority.
       if (PriBInfo.find(P) != PriBInfo.end()) {
         delete (PriBInfo[P]);
         PriBInfo.erase(P);
+        markBoundsChanged(L);
         RetVal = true;
       }
-      // If there are no other bounds then remove the key.
-      if (BInfo[L].empty()) {
-        BInfo.erase(L);
+      // If there are no other bounds then the key has no bounds.
+      if (PriBInfo.empty())
         RetVal = true;
-      }
     }
   }
   return RetVal;
@@ -760,8 +795,7 @@ bool AVarBoundsInfo::replaceBounds(BoundsKey L, BoundsPriority P, ABounds *B) {
 
 ABounds *AVarBoundsInfo::getBounds(BoundsKey L, BoundsPriority ReqP,
                                    BoundsPriority *RetP) {
-  if (InvalidBounds.find(L) == InvalidBounds.end() &&
-      BInfo.find(L) != BInfo.end()) {
+  if (!InvalidBounds.count(L) && hasBoundsInfo(L)) {
     auto &PriBInfo = BInfo[L];
     if (ReqP == Invalid) {
       // Fetch bounds by priority i.e., give the highest priority bounds.
@@ -808,8 +842,7 @@ BoundsKey AVarBoundsInfo::getVariable(clang::VarDecl *VD) {
       FunctionDecl *FD =
           dyn_cast<FunctionDecl>(VD->getParentFunctionOrMethod());
       if (FD != nullptr) {
-        PVS = FunctionScope::getFunctionScope(FD->getNameAsString(),
-                                              FD->isStatic());
+        PVS = Scopes.getFunctionScope(FD->getNameAsString(), FD->isStatic());
       }
     }
     assert(PVS != nullptr && "Context not null");
@@ -832,8 +865,8 @@ BoundsKey AVarBoundsInfo::getVariable(clang::ParmVarDecl *PVD) {
                                   FD->isStatic(), ParamIdx);
   if (ParamDeclVarMap.left().find(ParamKey) == ParamDeclVarMap.left().end()) {
     BoundsKey NK = ++BCount;
-    const FunctionParamScope *FPS = FunctionParamScope::getFunctionParamScope(
-        FD->getNameAsString(), FD->isStatic());
+    const FunctionParamScope *FPS =
+        Scopes.getFunctionParamScope(FD->getNameAsString(), FD->isStatic());
     std::string ParamName = PVD->getNameAsString();
     // If this is a parameter without name!?
     // Just get the name from argument number.
@@ -857,8 +890,8 @@ BoundsKey AVarBoundsInfo::getVariable(clang::FunctionDecl *FD) {
       std::make_tuple(FD->getNameAsString(), FileName, FD->isStatic());
   if (FuncDeclVarMap.left().find(FuncKey) == FuncDeclVarMap.left().end()) {
     BoundsKey NK = ++BCount;
-    const FunctionParamScope *FPS = FunctionParamScope::getFunctionParamScope(
-        FD->getNameAsString(), FD->isStatic());
+    const FunctionParamScope *FPS =
+        Scopes.getFunctionParamScope(FD->getNameAsString(), FD->isStatic());
 
     auto *PVar =
         ProgramVar::createNewProgramVar(NK, FD->getNameAsString(), FPS);
@@ -877,7 +910,7 @@ BoundsKey AVarBoundsInfo::getVariable(clang::FieldDecl *FD) {
     BoundsKey NK = ++BCount;
     insertVarKey(PSL, NK);
     std::string StName = FD->getParent()->getNameAsString();
-    const StructScope *SS = StructScope::getStructScope(StName);
+    const StructScope *SS = Scopes.getStructScope(StName);
     auto *PVar = ProgramVar::createNewProgramVar(NK, FD->getNameAsString(), SS);
     insertProgramVar(NK, PVar);
     if (isPtrOrArrayType(FD->getType()))
@@ -1034,10 +1067,11 @@ bool AVarBoundsInfo::handlePointerAssignment(clang::Stmt *St, clang::Expr *L,
 }
 
 void AVarBoundsInfo::mergeBoundsKey(BoundsKey To, BoundsKey From) {
-  if (InvalidBounds.find(To) != InvalidBounds.end() ||
-      InvalidBounds.find(From) != InvalidBounds.end()) {
-    InvalidBounds.insert(To);
-    InvalidBounds.insert(From);
+  if (InvalidBounds.count(To) || InvalidBounds.count(From)) {
+    if (InvalidBounds.insert(To))
+      markBoundsChanged(To);
+    if (InvalidBounds.insert(From))
+      markBoundsChanged(From);
   }
 }
 
@@ -1051,15 +1085,13 @@ void AVarBoundsInfo::recordArithmeticOperation(clang::Expr *E,
 }
 
 bool AVarBoundsInfo::hasPointerArithmetic(BoundsKey BK) {
-  return ArrPointersWithArithmetic.find(BK) != ArrPointersWithArithmetic.end();
+  return ArrPointersWithArithmetic.count(BK);
 }
 
 ProgramVar *AVarBoundsInfo::getProgramVar(BoundsKey VK) {
-  ProgramVar *Ret = nullptr;
-  if (PVarInfo.find(VK) != PVarInfo.end()) {
-    Ret = PVarInfo[VK];
-  }
-  return Ret;
+  if (VK < PVarInfo.size())
+    return PVarInfo[VK];
+  return nullptr;
 }
 
 bool AVarBoundsInfo::hasVarKey(PersistentSourceLoc &PSL) {
@@ -1072,13 +1104,14 @@ BoundsKey AVarBoundsInfo::getVarKey(PersistentSourceLoc &PSL) {
 }
 
 BoundsKey AVarBoundsInfo::getConstKey(uint64_t Value) {
-  if (ConstVarKeys.find(Value) == ConstVarKeys.end()) {
-    BoundsKey NK = ++BCount;
-    ProgramVar *NPV = ProgramVar::createNewConstantVar(NK, Value);
-    insertProgramVar(NK, NPV);
-    ConstVarKeys[Value] = NK;
-  }
-  return ConstVarKeys[Value];
+  auto It = ConstVarKeys.find(Value);
+  if (It != ConstVarKeys.end())
+    return It->second;
+  BoundsKey NK = ++BCount;
+  ProgramVar *NPV = ProgramVar::createNewConstantVar(NK, Value);
+  insertProgramVar(NK, NPV);
+  ConstVarKeys[Value] = NK;
+  return NK;
 }
 
 BoundsKey AVarBoundsInfo::getVarKey(llvm::APSInt &API) {
@@ -1095,12 +1128,16 @@ void AVarBoundsInfo::insertParamKey(AVarBoundsInfo::ParamDeclType ParamDecl,
 }
 
 void AVarBoundsInfo::insertProgramVar(BoundsKey NK, ProgramVar *PV) {
+  if (NK >= PVarInfo.size())
+    PVarInfo.resize(std::max<size_t>(NK + 1, PVarInfo.size() * 2), nullptr);
   PVarInfo[NK] = PV;
 }
 
 void AVarBoundsInfo::performWorkListInference(const AVarGraph &BKGraph,
                                               AvarBoundsInference &BI,
-                                              bool FromPB) {
+                                              bool FromPB,
+                                              const BoundsKeySet *Seed,
+                                              PerformanceStats &PStats) {
 
   // BoundsKeys corresponding to array pointers that need bounds. This will seed
   // the initial WorkList, and be used to ensure that only BoundsKeys needing
@@ -1108,7 +1145,13 @@ void AVarBoundsInfo::performWorkListInference(const AVarGraph &BKGraph,
   std::set<BoundsKey> ArrNeededBounds;
   getBoundsNeededArrPointers(ArrNeededBounds);
 
-  std::set<BoundsKey> WorkList(ArrNeededBounds);
+  std::set<BoundsKey> WorkList;
+  if (Seed == nullptr)
+    WorkList = ArrNeededBounds;
+  else
+    for (BoundsKey BK : ArrNeededBounds)
+      if (Seed->count(BK))
+        WorkList.insert(WorkList.end(), BK);
   while (!WorkList.empty()) {
     // This set will collect BoundsKeys which are successors of a BoundsKey that
     // was assigned a bound in this iteration. These subset of these that need
@@ -1119,7 +1162,9 @@ void AVarBoundsInfo::performWorkListInference(const AVarGraph &BKGraph,
       // inferBounds will return true if a bound was found for CurrArrKey. If a
       // bound can be found, queue the successor nodes for bounds inferences in
       // the next iteration of the outer loop.
+      PStats.ArrayBoundsKeysVisited++;
       if (BI.inferBounds(CurrArrKey, BKGraph, FromPB)) {
+        PStats.ArrayBoundsKeysInferred++;
         // Get all the successors of the ARR whose bounds we just found.
         // Successor BoundsKeys are added into NextIterArrs without clearing the
         // current contents.
@@ -1139,6 +1184,26 @@ void AVarBoundsInfo::performWorkListInference(const AVarGraph &BKGraph,
   BI.convergeInferredBounds();
 }
 
+void AVarBoundsInfo::getAffectedKeys(const BoundsKeySet &Keys,
+                                     BoundsKeySet &Affected) const {
+  std::vector<BoundsKey> WorkList;
+  for (BoundsKey BK : Keys)
+    if (Affected.insert(BK))
+      WorkList.push_back(BK);
+  std::set<BoundsKey> Succs;
+  while (!WorkList.empty()) {
+    BoundsKey BK = WorkList.back();
+    WorkList.pop_back();
+    for (const AVarGraph *G :
+         {&ProgVarGraph, &CtxSensProgVarGraph, &RevCtxSensProgVarGraph}) {
+      G->getSuccessors(BK, Succs);
+      for (BoundsKey Succ : Succs)
+        if (Affected.insert(Succ))
+          WorkList.push_back(Succ);
+    }
+  }
+}
+
 BoundsKey AVarBoundsInfo::getCtxSensCEBoundsKey(const PersistentSourceLoc &PSL,
                                                 BoundsKey BK) {
   return CSBKeyHandler.getCtxSensCEBoundsKey(PSL, BK);
@@ -1165,7 +1230,8 @@ void AVarBoundsInfo::computeArrPointers(const ProgramInfo *PI) {
       // placing incorrect bounds on null terminated arrays as discussed in
       // https://github.com/correctcomputation/checkedc-clang/issues/553
       if (CV->getName() == RETVAR && getBounds(BK) == nullptr)
-        PointersWithImpossibleBounds.insert(BK);
+        if (PointersWithImpossibleBounds.insert(BK))
+          markBoundsChanged(BK);
     }
   };
 
@@ -1237,31 +1303,22 @@ void AVarBoundsInfo::computeArrPointers(const ProgramInfo *PI) {
   }
 
   // All BoundsKey that have bounds are also array pointers.
-  for (auto &T : this->BInfo)
-    ArrPointerBoundsKey.insert(T.first);
+  for (BoundsKey BK = 0, E = BInfo.size(); BK < E; BK++)
+    if (!BInfo[BK].empty())
+      ArrPointerBoundsKey.insert(BK);
 }
 
 // Find the set of array pointers that need bounds. This is computed as all
 // array pointers that do not currently have a bound, have an invalid bound,
 // or have an impossible bound.
 void AVarBoundsInfo::getBoundsNeededArrPointers(std::set<BoundsKey> &AB) const {
-  // Get the ARR pointers that have bounds.
-  std::set<BoundsKey> ArrWithBounds;
-  for (auto &T : BInfo) {
-    ArrWithBounds.insert(T.first);
-  }
-  // Also add arrays with invalid bounds.
-  ArrWithBounds.insert(InvalidBounds.begin(), InvalidBounds.end());
-  // Also, add arrays with impossible bounds.
-  ArrWithBounds.insert(PointersWithImpossibleBounds.begin(),
-                       PointersWithImpossibleBounds.end());
-
-  // Remove the above set of array pointers with bounds from the set of all
-  // array pointers to get the set of array pointers that need bounds.
-  // i.e., AB = ArrPointerBoundsKey - ArrPtrsWithBounds.
-  std::set_difference(ArrPointerBoundsKey.begin(), ArrPointerBoundsKey.end(),
-                      ArrWithBounds.begin(), ArrWithBounds.end(),
-                      std::inserter(AB, AB.end()));
+  // An array pointer needs bounds unless it has bounds, has invalid bounds or
+  // has impossible bounds. i.e., AB = ArrPointerBoundsKey - ArrPtrsWithBounds.
+  // Keys come out in ascending order, so hint each insertion at the end.
+  for (BoundsKey BK : ArrPointerBoundsKey)
+    if (!hasBoundsInfo(BK) && !InvalidBounds.count(BK) &&
+        !PointersWithImpossibleBounds.count(BK))
+      AB.insert(AB.end(), BK);
 }
 
 // We first propagate all the bounds information from explicit
@@ -1300,6 +1357,16 @@ void AVarBoundsInfo::performFlowAnalysis(ProgramInfo *PI) {
   // We iterate until there are no new array variables whose bounds are found.
   // The expectation is every iteration we will find bounds for at least one
   // array variable.
+  // A round reads only the bounds state of this object (see ChangedKeys) along
+  // with data that is fixed during this analysis, and the inference for a key
+  // reads only the state of the key and of its predecessors. So after the
+  // first round with a given FromPB, a round visits only the keys reachable
+  // from those whose state changed since the previous round with that FromPB
+  // began. Every other key takes its inferred bounds from that round. A round
+  // that would visit no key is skipped.
+  Optional<AvarBoundsInference> Saved[2][3];
+  PStats.ArrayBoundsRuns++;
+
   bool OuterChanged = !ArrNeededBounds.empty();
   while (OuterChanged) {
     std::set<BoundsKey> TmpArrNeededBounds = ArrNeededBounds;
@@ -1312,14 +1379,37 @@ void AVarBoundsInfo::performFlowAnalysis(ProgramInfo *PI) {
     for (bool FromPB : std::vector<bool>({false, true})) {
       bool InnerChanged = !ArrNeededBounds.empty();
       while (InnerChanged) {
+        bool Incremental = !NoIncrementalBounds && Saved[FromPB][0].hasValue();
+        BoundsKeySet Affected;
+        if (Incremental) {
+          getAffectedKeys(ChangedKeys[FromPB], Affected);
+          if (llvm::none_of(ArrNeededBounds, [&Affected](BoundsKey BK) {
+                return Affected.count(BK);
+              })) {
+            PStats.ArrayBoundsRoundsSkipped++;
+            break;
+          }
+        }
+        const BoundsKeySet *Seed = Incremental ? &Affected : nullptr;
+        ChangedKeys[FromPB].clear();
+        PStats.ArrayBoundsRounds++;
+
         AvarBoundsInference ABI(this);
         // Regular flow inference (with no edges between callers and callees).
-        performWorkListInference(this->ProgVarGraph, ABI, FromPB);
+        if (Incremental)
+          ABI.reuseInferredBounds(*Saved[FromPB][0], Affected);
+        performWorkListInference(this->ProgVarGraph, ABI, FromPB, Seed,
+                                 PStats);
+        Saved[FromPB][0] = ABI;
 
         // Now propagate the bounds information from context-sensitive keys to
         // original keys (i.e., edges from callers to callees are present, but no
         // local edges).
-        performWorkListInference(this->CtxSensProgVarGraph, ABI, FromPB);
+        if (Incremental)
+          ABI.reuseInferredBounds(*Saved[FromPB][1], Affected);
+        performWorkListInference(this->CtxSensProgVarGraph, ABI, FromPB, Seed,
+                                 PStats);
+        Saved[FromPB][1] = ABI;
 
         // Now clear all inferred bounds so that context-sensitive nodes do not
         // interfere with each other.
@@ -1327,7 +1417,11 @@ void AVarBoundsInfo::performFlowAnalysis(ProgramInfo *PI) {
 
         // Now propagate the bounds information from normal keys to
         // context-sensitive keys.
-        performWorkListInference(this->RevCtxSensProgVarGraph, ABI, FromPB);
+        if (Incremental)
+          ABI.reuseInferredBounds(*Saved[FromPB][2], Affected);
+        performWorkListInference(this->RevCtxSensProgVarGraph, ABI, FromPB,
+                                 Seed, PStats);
+        Saved[FromPB][2] = ABI;
 
         // Get array variables that still need bounds.
         std::set<BoundsKey> ArrNeededBoundsNew;
@@ -1394,8 +1488,18 @@ bool AVarBoundsInfo::isFunctionReturn(BoundsKey BK) {
   return (FuncDeclVarMap.right().find(BK) != FuncDeclVarMap.right().end());
 }
 
-void AVarBoundsInfo::printStats(llvm::raw_ostream &O, const CVarSet &SrcCVarSet,
-                                bool JsonFormat) const {
+void AVarBoundsInfo::addReachabilityCacheStats(size_t &Nodes,
+                                               size_t &Evictions) const {
+  for (const AVarGraph *G :
+       {&ProgVarGraph, &CtxSensProgVarGraph, &RevCtxSensProgVarGraph}) {
+    Nodes += G->getBFSCacheNodes();
+    Evictions += G->getBFSCacheEvictions();
+  }
+}
+
+void AVarBoundsInfo::getStatsKeys(
+    const CVarSet &SrcCVarSet, std::set<BoundsKey> &InSrcArrBKeys,
+    std::set<BoundsKey> &NTArrayReqNoBounds) const {
   std::set<BoundsKey> InSrcBKeys;
   for (auto *C : SrcCVarSet) {
     if (C->isForValidDecl() && C->hasBoundsKey())
@@ -1404,44 +1508,53 @@ void AVarBoundsInfo::printStats(llvm::raw_ostream &O, const CVarSet &SrcCVarSet,
 
   std::set<BoundsKey> NTArraysReqBnds;
   for (auto NTBK : NtArrPointerBoundsKey) {
-    ProgVarGraph.visitBreadthFirst(NTBK, [this, NTBK, &NTArraysReqBnds](BoundsKey BK) {
-      if (NtArrPointerBoundsKey.find(BK) == NtArrPointerBoundsKey.end() &&
-        ArrPointerBoundsKey.find(BK) != ArrPointerBoundsKey.end())
-        NTArraysReqBnds.insert(NTBK);
-    });
+    ProgVarGraph.visitBreadthFirst(
+        NTBK, [this, NTBK, &NTArraysReqBnds](BoundsKey BK) {
+          if (!NtArrPointerBoundsKey.count(BK) && ArrPointerBoundsKey.count(BK))
+            NTArraysReqBnds.insert(NTBK);
+        });
   }
 
-  std::set<BoundsKey> NTArrayReqNoBounds;
   std::set_difference(
       NtArrPointerBoundsKey.begin(), NtArrPointerBoundsKey.end(),
       NTArraysReqBnds.begin(), NTArraysReqBnds.end(),
       std::inserter(NTArrayReqNoBounds, NTArrayReqNoBounds.begin()));
 
-  std::set<BoundsKey> InSrcArrBKeys;
   findIntersection(InProgramArrPtrBoundsKeys, InSrcBKeys, InSrcArrBKeys);
+}
+
+void AVarBoundsInfo::printStats(llvm::raw_ostream &O,
+                                const CVarSet &SrcCVarSet) const {
+  std::set<BoundsKey> InSrcArrBKeys, NTArrayReqNoBounds;
+  getStatsKeys(SrcCVarSet, InSrcArrBKeys, NTArrayReqNoBounds);
   std::set<BoundsKey> Tmp;
-  if (!JsonFormat) {
-    findIntersection(ArrPointerBoundsKey, InSrcArrBKeys, Tmp);
-    O << "NumPointersNeedBounds:" << Tmp.size() << ",\n";
-    findIntersection(NTArrayReqNoBounds, InSrcArrBKeys, Tmp);
-    O << "NumNTNoBounds:" << Tmp.size() << ",\n";
-    O << "Details:\n";
-    findIntersection(InvalidBounds, InSrcArrBKeys, Tmp);
-    O << "Invalid:" << Tmp.size() << "\n,BoundsFound:\n";
-    BoundsInferStats.print(O, &InSrcArrBKeys, JsonFormat);
-  } else {
+  findIntersection(ArrPointerBoundsKey, InSrcArrBKeys, Tmp);
+  O << "NumPointersNeedBounds:" << Tmp.size() << ",\n";
+  findIntersection(NTArrayReqNoBounds, InSrcArrBKeys, Tmp);
+  O << "NumNTNoBounds:" << Tmp.size() << ",\n";
+  O << "Details:\n";
+  findIntersection(InvalidBounds, InSrcArrBKeys, Tmp);
+  O << "Invalid:" << Tmp.size() << "\n,BoundsFound:\n";
+  BoundsInferStats.print(O, &InSrcArrBKeys);
+}
+
+void AVarBoundsInfo::printStats(llvm::json::OStream &J,
+                                const CVarSet &SrcCVarSet) const {
+  std::set<BoundsKey> InSrcArrBKeys, NTArrayReqNoBounds;
+  getStatsKeys(SrcCVarSet, InSrcArrBKeys, NTArrayReqNoBounds);
+  std::set<BoundsKey> Tmp;
+  J.object([&] {
     findIntersection(ArrPointerBoundsKey, InSrcArrBKeys, Tmp);
-    O << "{\"NumPointersNeedBounds\":" << Tmp.size() << ",";
+    J.attribute("NumPointersNeedBounds", int64_t(Tmp.size()));
     findIntersection(NTArrayReqNoBounds, InSrcArrBKeys, Tmp);
-    O << "\"NumNTNoBounds\":" << Tmp.size() << ",";
-    O << "\"Details\":{";
-    findIntersection(InvalidBounds, InSrcArrBKeys, Tmp);
-    O << "\"Invalid\":" << Tmp.size() << ",\"BoundsFound\":{";
-    BoundsInferStats.print(O, &InSrcArrBKeys, JsonFormat);
-    O << "}";
-    O << "}";
-    O << "}";
-  }
+    J.attribute("NumNTNoBounds", int64_t(Tmp.size()));
+    J.attributeObject("Details", [&] {
+      findIntersection(InvalidBounds, InSrcArrBKeys, Tmp);
+      J.attribute("Invalid", int64_t(Tmp.size()));
+      J.attributeObject("BoundsFound",
+                        [&] { BoundsInferStats.print(J, &InSrcArrBKeys); });
+    });
+  });
 }
 
 bool AVarBoundsInfo::areSameProgramVar(BoundsKey B1, BoundsKey B2) {
@@ -18,10 +18,8 @@ std::string llvm::DOTGraphTraits<AVarGraph>::getNodeAttributes(
     const DataNode<BoundsKey> *Node, const AVarGraph &G) {
   AVarBoundsInfo *ABInfo = G.ABInfo;
   BoundsKey BK = Node->getData();
-  bool IsPtr =
-      ABInfo->PointerBoundsKey.find(BK) != ABInfo->PointerBoundsKey.end();
-  bool IsArrPtr =
-      ABInfo->ArrPointerBoundsKey.find(BK) != ABInfo->ArrPointerBoundsKey.end();
+  bool IsPtr = ABInfo->PointerBoundsKey.count(BK);
+  bool IsArrPtr = ABInfo->ArrPointerBoundsKey.count(BK);
   // If this is a regular pointer? Ignore.
   if (IsPtr && !IsArrPtr)
     return "";
@@ -64,8 +62,7 @@ llvm::DOTGraphTraits<AVarGraph>::getNodeLabel(const DataNode<BoundsKey> *Node,
   std::string LblStr = "Temp";
   if (Tmp != nullptr)
     LblStr = Tmp->verboseStr();
-  bool IsArrPtr =
-      ABInfo->ArrPointerBoundsKey.find(BK) != ABInfo->ArrPointerBoundsKey.end();
+  bool IsArrPtr = ABInfo->ArrPointerBoundsKey.count(BK);
   if (IsArrPtr)
     if (auto *B = ABInfo->getBounds(BK))
       LblStr += "(B:" + B->mkString(ABInfo) + ")";
@@ -39,22 +39,26 @@ FunctionDecl *getFunctionDeclOfBody(ASTContext *Context, CompoundStmt *S) {
 
 // CheckedRegionAdder
 
-bool CheckedRegionAdder::VisitCompoundStmt(CompoundStmt *S) {
-  llvm::FoldingSetNodeID Id;
-  DynTypedNode DTN = DynTypedNode::create(*S);
+bool CheckedRegionAdder::TraverseCompoundStmt(CompoundStmt *S) {
+  EnclosingCompounds.push_back(S);
+  bool Continue =
+      RecursiveASTVisitor<CheckedRegionAdder>::TraverseCompoundStmt(S);
+  EnclosingCompounds.pop_back();
+  return Continue;
+}
 
+bool CheckedRegionAdder::VisitCompoundStmt(CompoundStmt *S) {
   auto &PState = Info.getPerfStats();
-  S->Profile(Id, *Context, true);
-  switch (Map[Id]) {
+  switch (Map.lookup(S)) {
   case IS_UNCHECKED:
-    if (isParentChecked(DTN) && getFunctionDeclOfBody(Context, S) == nullptr) {
+    if (isParentChecked(S) && getFunctionDeclOfBody(Context, S) == nullptr) {
       auto Loc = S->getBeginLoc();
       Writer.InsertTextBefore(Loc, "_Unchecked ");
       PState.incrementNumUnCheckedRegions();
     }
     break;
   case IS_CHECKED:
-    if (!isParentChecked(DTN)) {
+    if (!isParentChecked(S)) {
       auto Loc = S->getBeginLoc();
       Writer.InsertTextBefore(Loc, "_Checked ");
       PState.incrementNumCheckedRegions();
@@ -69,13 +73,10 @@ bool CheckedRegionAdder::VisitCompoundStmt(CompoundStmt *S) {
 
 bool CheckedRegionAdder::VisitCallExpr(CallExpr *C) {
   auto *FD = C->getDirectCallee();
-  FoldingSetNodeID ID;
-  DynTypedNode DTN = DynTypedNode::create(*C);
   auto &PState = Info.getPerfStats();
 
-  C->Profile(ID, *Context, true);
-  if (FD && FD->isVariadic() && Map[ID] == IS_CONTAINED &&
-      isParentChecked(DTN)) {
+  if (FD && FD->isVariadic() && Map.lookup(C) == IS_CONTAINED &&
+      isParentChecked(C)) {
     auto Begin = C->getBeginLoc();
     Writer.InsertTextBefore(Begin, "_Unchecked { ");
     auto End = C->getEndLoc();
@@ -86,34 +87,21 @@ bool CheckedRegionAdder::VisitCallExpr(CallExpr *C) {
   return true;
 }
 
-typedef std::pair<const CompoundStmt *, int> StmtPair;
-
-StmtPair
-CheckedRegionAdder::findParentCompound(const DynTypedNode &N,
-                                       int Distance = 1) {
-  auto Parents = Context->getParents(N);
-  if (Parents.empty())
-    return std::make_pair(nullptr, INT_MAX);
-  std::vector<StmtPair> Results;
-  Results.reserve(Parents.size());
-  for (auto Parent : Parents)
-    if (const auto *S = Parent.get<CompoundStmt>())
-      Results.push_back(std::make_pair(S, Distance));
-    else
-      Results.push_back(findParentCompound(Parent, Distance + 1));
-
-  auto Min = min_element(
-      Results.begin(), Results.end(),
-      [](const StmtPair &A, const StmtPair &B) { return A.second < B.second; });
-  return *Min;
+// The nearest compound statement strictly enclosing S, which must be at the
+// current point of the traversal. This is tracked during the traversal rather
+// than found by walking up the parent map from every statement.
+const CompoundStmt *
+CheckedRegionAdder::getEnclosingCompound(const Stmt *S) {
+  auto It = EnclosingCompounds.rbegin();
+  // While a compound statement is visited, it is itself on top of the stack.
+  if (It != EnclosingCompounds.rend() && *It == S)
+    ++It;
+  return It != EnclosingCompounds.rend() ? *It : nullptr;
 }
 
-bool CheckedRegionAdder::isParentChecked(const DynTypedNode &DTN) {
-  if (const auto *Parent = findParentCompound(DTN).first) {
-    llvm::FoldingSetNodeID ID;
-    Parent->Profile(ID, *Context, true);
-    return Map[ID] == IS_CHECKED || isWrittenChecked(Parent);
-  }
+bool CheckedRegionAdder::isParentChecked(const Stmt *S) {
+  if (const auto *Parent = getEnclosingCompound(S))
+    return Map.lookup(Parent) == IS_CHECKED || isWrittenChecked(Parent);
   return false;
 }
 
@@ -199,9 +187,7 @@ bool CheckedRegionFinder::VisitCompoundStmt(CompoundStmt *S) {
 
   Wild = false;
 
-  llvm::FoldingSetNodeID Id;
-  S->Profile(Id, *Context, true);
-  Seen.insert(Id);
+  Seen.insert(S);
 
   // Compound Statements should be the bottom of the visitor,
   // as it creates it's own sub-visitor.
@@ -221,11 +207,9 @@ bool CheckedRegionFinder::VisitCStyleCastExpr(CStyleCastExpr *E) {
 
 bool CheckedRegionFinder::VisitCallExpr(CallExpr *C) {
   auto *FD = C->getDirectCallee();
-  FoldingSetNodeID ID;
-  C->Profile(ID, *Context, true);
   if (FD && FD->isVariadic()) {
     Wild = !isInStatementPosition(C);
-    Map[ID] = isInStatementPosition(C) ? IS_CONTAINED : IS_UNCHECKED;
+    Map[C] = isInStatementPosition(C) ? IS_CONTAINED : IS_UNCHECKED;
   } else {
     if (FD) {
       if (Info.hasTypeParamBindings(C, Context))
@@ -239,7 +223,7 @@ bool CheckedRegionFinder::VisitCallExpr(CallExpr *C) {
         Wild |= isWild(*FV->getExternalParam(I));
     }
     handleChildren(C->children());
-    Map[ID] = Wild ? IS_UNCHECKED : IS_CHECKED;
+    Map[C] = Wild ? IS_UNCHECKED : IS_CHECKED;
   }
 
   return false;
@@ -421,13 +405,11 @@ bool CheckedRegionFinder::isUncheckedStruct(QualType Qt,
 // whether or not it is checked
 void CheckedRegionFinder::markChecked(CompoundStmt *S, int Localwild) {
   auto Cur = S->getWrittenCheckedSpecifier();
-  llvm::FoldingSetNodeID Id;
-  S->Profile(Id, *Context, true);
 
   bool IsChecked = !hasUncheckedParameters(S) &&
                    Cur == CheckedScopeSpecifier::CSS_None && Localwild == 0;
 
-  Map[Id] = IsChecked ? IS_CHECKED : IS_UNCHECKED;
+  Map[S] = IsChecked ? IS_CHECKED : IS_UNCHECKED;
 }
 
 void CheckedRegionFinder::emitCauseDiagnostic(PersistentSourceLoc PSL) {
@@ -16,6 +16,7 @@
 #include "clang/3C/ConstraintResolver.h"
 #include "clang/3C/TypeVariableAnalysis.h"
 #include "clang/ASTMatchers/ASTMatchers.h"
+#include "llvm/Support/TimeProfiler.h"
 #include <algorithm>
 
 using namespace llvm;
@@ -638,12 +639,17 @@ void VariableAdderConsumer::HandleTranslationUnit(ASTContext &C) {
       errs() << "Analyzing\n";
   }
 
+  llvm::TimeTraceScope TraceScope("3C variable adder", [&C] {
+    return PerformanceStats::getTUName(C);
+  });
+  WallClockTimer TUTimer;
   VariableAdderVisitor VAV = VariableAdderVisitor(&C, Info);
   TranslationUnitDecl *TUD = C.getTranslationUnitDecl();
   // Collect Variables.
   for (const auto &D : TUD->decls()) {
     VAV.TraverseDecl(D);
   }
+  Info.getPerfStats().getTUTimes(C).VariableAdderTime += TUTimer.seconds();
 
   if (_3COpts.Verbose)
     errs() << "Done analyzing\n";
@@ -652,6 +658,116 @@ void VariableAdderConsumer::HandleTranslationUnit(ASTContext &C) {
   return;
 }
 
+void VariableAdderShard::collect(ASTContext &C) {
+  assert(Context == nullptr && "A shard holds a single translation unit.");
+  Context = &C;
+  WallClockTimer TUTimer;
+  VariableAdderVisitor VAV = VariableAdderVisitor(&C, *this);
+  TranslationUnitDecl *TUD = C.getTranslationUnitDecl();
+  for (const auto &D : TUD->decls()) {
+    VAV.TraverseDecl(D);
+  }
+  CollectTime = TUTimer.seconds();
+}
+
+void VariableAdderShard::mergeInto(ProgramInfo &Info) {
+  assert(Context != nullptr && "Merging a shard that was never collected.");
+  Info.enterCompilationUnit(*Context);
+  WallClockTimer TUTimer;
+  if (_3COpts.Verbose) {
+    SourceManager &SM = Context->getSourceManager();
+    const FileEntry *FE = SM.getFileEntryForID(SM.getMainFileID());
+    if (FE != nullptr)
+      errs() << "Analyzing file " << FE->getName() << "\n";
+    else
+      errs() << "Analyzing\n";
+  }
+
+  // Replay the visitor's calls so that the result is the same as running
+  // VariableAdderConsumer on this translation unit.
+  Info.setPrecomputedTypeStrings(&TypeStrings);
+  for (Entry &E : Entries) {
+    switch (E.Kind) {
+    case Entry::EK_Variable:
+      Info.addVariable(cast<DeclaratorDecl>(E.D), Context, E.PSL);
+      break;
+    case Entry::EK_ABoundsVariable:
+      Info.addABoundsVariable(E.D);
+      break;
+    case Entry::EK_Typedef:
+      // An earlier translation unit may have added the same typedef.
+      if (!Info.seenTypedef(E.PSL))
+        Info.addTypedef(E.PSL, E.CanRewriteDef, cast<TypedefDecl>(E.D),
+                        *Context);
+      break;
+    }
+  }
+
+  Info.setPrecomputedTypeStrings(nullptr);
+
+  if (_3COpts.Verbose)
+    errs() << "Done analyzing\n";
+  Info.getPerfStats().getTUTimes(*Context).VariableAdderTime +=
+      CollectTime + TUTimer.seconds();
+  Info.exitCompilationUnit();
+}
+
+void VariableAdderShard::addVariable(DeclaratorDecl *D, ASTContext *AstContext) {
+  assert(AstContext == Context);
+  Entries.push_back({Entry::EK_Variable, D,
+                     PersistentSourceLoc::mkPSL(D, *AstContext), false});
+
+  // The strings printed by the FVConstraint and PVConstraint constructors.
+  // Any that are missed here are printed during the merge.
+  StringRef Name =
+      D->getDeclName().isIdentifier() ? D->getName() : StringRef();
+  if (FunctionDecl *FD = dyn_cast<FunctionDecl>(D)) {
+    addTypeStrings(FD->getType(), Name);
+    addTypeStrings(FD->getReturnType(), "");
+    if (const auto *FT = FD->getType()->getAs<FunctionProtoType>())
+      for (unsigned J = 0; J < FT->getNumParams(); J++)
+        addTypeStrings(FT->getParamType(J),
+                       J < FD->getNumParams() ? FD->getParamDecl(J)->getName()
+                                              : StringRef());
+  } else {
+    QualType QT = D->getType();
+    if (QT->isPointerType() || QT->isArrayType())
+      addTypeStrings(QT, Name);
+  }
+}
+
+void VariableAdderShard::addTypeStrings(QualType QT, StringRef Name) {
+  auto Add = [this](QualType T, StringRef N) {
+    auto Key = std::make_pair(T.getAsOpaquePtr(), N);
+    if (TypeStrings.find(Key) == TypeStrings.end())
+      TypeStrings[Key] = qtyToStr(T, N.str());
+  };
+  Add(QT, "");
+  Add(QT, Name);
+  const Type *Ty = QT.getTypePtr();
+  while (Ty->isPointerType() || Ty->isArrayType()) {
+    Add(QualType(Ty, 0), "");
+    Ty = Ty->getPointeeOrArrayElementType();
+  }
+}
+
+void VariableAdderShard::addABoundsVariable(Decl *D) {
+  Entries.push_back({Entry::EK_ABoundsVariable, D, PersistentSourceLoc(),
+                     false});
+}
+
+bool VariableAdderShard::seenTypedef(PersistentSourceLoc PSL) {
+  return SeenTypedefs.find(PSL) != SeenTypedefs.end();
+}
+
+void VariableAdderShard::addTypedef(PersistentSourceLoc PSL,
+                                    bool CanRewriteDef, TypedefDecl *TD,
+                                    ASTContext &C) {
+  assert(&C == Context);
+  SeenTypedefs.insert(PSL);
+  Entries.push_back({Entry::EK_Typedef, TD, PSL, CanRewriteDef});
+}
+
 void ConstraintBuilderConsumer::HandleTranslationUnit(ASTContext &C) {
   Info.enterCompilationUnit(C);
   if (_3COpts.Verbose) {
@@ -665,9 +781,18 @@ void ConstraintBuilderConsumer::HandleTranslationUnit(ASTContext &C) {
   }
 
   auto &PStats = Info.getPerfStats();
+  llvm::TimeTraceScope TraceScope("3C constraint builder", [&C] {
+    return PerformanceStats::getTUName(C);
+  });
+  WallClockTimer TUTimer;
 
   PStats.startConstraintBuilderTime();
 
+  // Nothing reads the constraint graphs during constraint generation, so the
+  // constraints of the translation unit are committed together at the end.
+  Constraints &CS = Info.getConstraints();
+  CS.beginConstraintBatch();
+
   TypeVarVisitor TV = TypeVarVisitor(&C, Info);
   ConstraintResolver CSResolver(Info, &C);
   ContextSensitiveBoundsKeyVisitor CSBV =
@@ -694,12 +819,13 @@ void ConstraintBuilderConsumer::HandleTranslationUnit(ASTContext &C) {
     SR.TraverseDecl(D);
   }
 
+  CS.commitConstraintBatch();
+
   if (_3COpts.Verbose)
     errs() << "Done analyzing\n";
 
   PStats.endConstraintBuilderTime();
-
-  PStats.endConstraintBuilderTime();
+  PStats.getTUTimes(C).ConstraintBuilderTime += TUTimer.seconds();
 
   Info.exitCompilationUnit();
   return;
@@ -49,7 +49,7 @@ std::string ConstraintVariable::getRewritableOriginalTy() const {
 std::string ConstraintVariable::getOriginalTypeWithName() const {
   if (Name == RETVAR)
     return getRewritableOriginalTy();
-  return OriginalTypeWithName;
+  return OriginalTypeWithName.str();
 }
 
 PointerVariableConstraint *PointerVariableConstraint::getWildPVConstraint(
@@ -108,7 +108,7 @@ PointerVariableConstraint *PointerVariableConstraint::addAtomPVConstraint(
   std::vector<Atom *> &Vars = Copy->Vars;
   std::vector<ConstAtom *> &SrcVars = Copy->SrcVars;
 
-  VarAtom *NewA = CS.getFreshVar("&" + Copy->Name, VarAtom::V_Other);
+  VarAtom *NewA = CS.getFreshVar("&" + Copy->Name.str(), VarAtom::V_Other);
   CS.addConstraint(CS.createGeq(NewA, PtrTyp, Rsn, false));
 
   // Add a constraint between the new atom and any existing atom for this
@@ -117,7 +117,7 @@ PointerVariableConstraint *PointerVariableConstraint::addAtomPVConstraint(
   // atoms to be wild if an outer atom is wild.
   if (!Vars.empty())
     if (auto *VA = dyn_cast<VarAtom>(*Vars.begin()))
-      CS.addConstraint(new Geq(VA, NewA,
+      CS.addConstraint(CS.createGeq(VA, NewA,
                        ReasonLoc(INNER_POINTER_REASON, PersistentSourceLoc())));
 
   Vars.insert(Vars.begin(), NewA);
@@ -126,6 +126,11 @@ PointerVariableConstraint *PointerVariableConstraint::addAtomPVConstraint(
   return Copy;
 }
 
+ConstraintVariable::ConstraintVariable(ConstraintVariableKind K, QualType QT,
+                                       std::string N, ProgramInfo &I)
+    : ConstraintVariable(K, I.getTypeString(QT), N,
+                         I.getTypeString(QT, N == RETVAR ? "" : N)) {}
+
 PointerVariableConstraint::PointerVariableConstraint(
     PointerVariableConstraint *Ot)
   : ConstraintVariable(ConstraintVariable::PointerVariable, Ot->OriginalType,
@@ -214,7 +219,7 @@ PointerVariableConstraint::PointerVariableConstraint(
     const ASTContext &C, std::string *InFunc, int ForceGenericIndex,
     bool PotentialGeneric,
     bool VarAtomForChecked, TypeSourceInfo *TSInfo, const QualType &ITypeT)
-    : ConstraintVariable(ConstraintVariable::PointerVariable, QT, N),
+    : ConstraintVariable(ConstraintVariable::PointerVariable, QT, N, I),
       FV(nullptr), SrcHasItype(false), PartOfFuncPrototype(InFunc != nullptr),
       Parent(nullptr) {
   PersistentSourceLoc PSL = PersistentSourceLoc::mkPSL(D, C);
@@ -249,7 +254,7 @@ PointerVariableConstraint::PointerVariableConstraint(
       if (BExpr != nullptr) {
         SourceRange R = BExpr->getSourceRange();
         if (R.isValid()) {
-          BoundsAnnotationStr = getSourceText(R, C);
+          BoundsAnnotationStr = internString(getSourceText(R, C));
         }
         if (D->hasBoundsAnnotations() && ABInfo.isValidBoundVariable(D)) {
           assert(ABInfo.tryGetVariable(D, BKey) &&
@@ -288,7 +293,7 @@ PointerVariableConstraint::PointerVariableConstraint(
 
         SourceRange R = ITE->getSourceRange();
         if (R.isValid()) {
-          ItypeStr = getSourceText(R, C);
+          ItypeStr = internString(getSourceText(R, C));
         }
 
         // ITE->isCompilerGenerated will be true when an itype expression is
@@ -298,7 +303,8 @@ PointerVariableConstraint::PointerVariableConstraint(
         // from the AST.
         if (!ITE->isCompilerGenerated() && ItypeStr.empty()) {
           assert(!InteropType.getAsString().empty());
-          ItypeStr = "itype(" + InteropType.getAsString() + ")";
+          ItypeStr =
+              internString("itype(" + InteropType.getAsString() + ")");
         }
       }
     }
@@ -357,7 +363,7 @@ PointerVariableConstraint::PointerVariableConstraint(
     bool VarCreated = false;
 
     // Is this a VarArg type?
-    std::string TyName = tyToStr(Ty);
+    std::string TyName = I.getTypeString(QualType(Ty, 0));
     if (isVarArgType(TyName)) {
       // Variable number of arguments. Make it WILD.
       auto Rsn = ReasonLoc("Variable number of arguments.", PSL);
@@ -440,7 +446,7 @@ PointerVariableConstraint::PointerVariableConstraint(
           if (!ArrTLoc.isNull()) {
             std::string SizeStr = getSourceText(ArrTLoc.getBracketsRange(), C);
             if (!SizeStr.empty())
-              ArrSizeStrs[TypeIdx] = SizeStr;
+              ArrSizeStrs[TypeIdx] = internString(SizeStr);
           }
         }
       } else {
@@ -515,7 +521,7 @@ PointerVariableConstraint::PointerVariableConstraint(
                           TSInfo);
 
   // Get a string representing the type without pointer and array indirection.
-  BaseType = extractBaseType(D, TSInfo, QT, Ty, C);
+  BaseType = internString(extractBaseType(D, TSInfo, QT, Ty, C));
 
   // check if the type is some depth of pointers to void
   // TODO: is this what the field should mean? do we want to include other
@@ -523,7 +529,7 @@ PointerVariableConstraint::PointerVariableConstraint(
   // https://github.com/correctcomputation/checkedc-clang/issues/648
   IsVoidPtr = QT->isPointerType() && isTypeHasVoid(QT);
   // varargs are always wild, as are void pointers that are not generic
-  bool IsWild = isVarArgType(BaseType) ||
+  bool IsWild = isVarArgType(BaseType.str()) ||
       (!(PotentialGeneric || isGeneric()) && IsVoidPtr);
   if (IsWild) {
     std::string Rsn =
@@ -537,7 +543,7 @@ PointerVariableConstraint::PointerVariableConstraint(
   // Add qualifiers.
   std::ostringstream QualStr;
   getQualString(TypeIdx, QualStr);
-  BaseType = QualStr.str() + BaseType;
+  BaseType = internString(QualStr.str() + BaseType.str());
 
   // If an outer pointer is wild, then the inner pointer must also be wild.
   if (Vars.size() > 1) {
@@ -545,7 +551,8 @@ PointerVariableConstraint::PointerVariableConstraint(
       VarAtom *VI = dyn_cast<VarAtom>(Vars[VarIdx]);
       VarAtom *VJ = dyn_cast<VarAtom>(Vars[VarIdx + 1]);
       if (VI && VJ)
-        CS.addConstraint(new Geq(VJ, VI, ReasonLoc(INNER_POINTER_REASON, PSL)));
+        CS.addConstraint(
+            CS.createGeq(VJ, VI, ReasonLoc(INNER_POINTER_REASON, PSL)));
     }
   }
 }
@@ -623,24 +630,21 @@ void PointerVariableConstraint::print(raw_ostream &O) const {
   }
 }
 
-void PointerVariableConstraint::dumpJson(llvm::raw_ostream &O) const {
-  O << "{\"PointerVar\":{";
-  O << "\"Vars\":[";
-  bool AddComma = false;
-  for (const auto &I : Vars) {
-    if (AddComma) {
-      O << ",";
-    }
-    I->dumpJson(O);
-
-    AddComma = true;
-  }
-  O << "], \"name\":\"" << getName() << "\"";
-  if (FV) {
-    O << ", \"FunctionVariable\":";
-    FV->dumpJson(O);
-  }
-  O << "}}";
+void PointerVariableConstraint::dumpJson(llvm::json::OStream &J) const {
+  J.object([&] {
+    J.attributeObject("PointerVar", [&] {
+      J.attributeArray("Vars", [&] {
+        for (const auto &I : Vars)
+          I->dumpJson(J);
+      });
+      J.attribute("name", getName());
+      if (FV) {
+        J.attributeBegin("FunctionVariable");
+        FV->dumpJson(J);
+        J.attributeEnd();
+      }
+    });
+  });
 }
 
 void PointerVariableConstraint::getQualString(uint32_t TypeIdx,
@@ -688,7 +692,7 @@ bool PointerVariableConstraint::emitArraySize(
     if (Kind != Atom::A_Wild)
       SizeStr << (Kind == Atom::A_NTArr ? " _Nt_checked" : " _Checked");
     if (ArrSizeStrs.find(TypeIdx) != ArrSizeStrs.end()) {
-      std::string SrcSizeStr = ArrSizeStrs.find(TypeIdx)->second;
+      std::string SrcSizeStr = ArrSizeStrs.find(TypeIdx)->second.str();
       assert(!SrcSizeStr.empty());
       // In some weird edge cases the size of the array is defined by a macro
       // where the macro also includes the brackets. We need to add a space
@@ -726,7 +730,7 @@ void PointerVariableConstraint::setTypedef(ConstraintVariable *TDVar,
                                            std::string S) {
   IsTypedef = true;
   TypedefVar = TDVar;
-  TypedefString = S;
+  TypedefString = internString(S);
 }
 
 const ConstraintVariable *PointerVariableConstraint::getTypedefVar() const {
@@ -765,7 +769,7 @@ PointerVariableConstraint::mkString(Constraints &CS,
   }
 
   if (IsTypedef && !UnmaskTypedef) {
-    std::string QualTypedef = gatherQualStrings() + TypedefString;
+    std::string QualTypedef = gatherQualStrings() + TypedefString.str();
     if (!ForItype)
       QualTypedef += " ";
     if (EmitName && !IsReturn)
@@ -796,7 +800,7 @@ PointerVariableConstraint::mkString(Constraints &CS,
   // If we've set a GenericIndex for void, it means we're converting it into
   // a generic function so give it the default generic type name.
   // Add more type names below if we expect to use a lot.
-  std::string BaseTypeName = BaseType;
+  std::string BaseTypeName = BaseType.str();
   if (InferredGenericIndex > -1 && isVoidPtr() &&
       isSolutionChecked(CS.getVariables())) {
     assert(InferredGenericIndex < 3
@@ -1007,7 +1011,7 @@ FunctionVariableConstraint::FunctionVariableConstraint(TypedefDecl *D,
 FunctionVariableConstraint::FunctionVariableConstraint(
     const QualType QT, DeclaratorDecl *D, std::string N, ProgramInfo &I,
     const ASTContext &Ctx, TypeSourceInfo *TSInfo)
-    : ConstraintVariable(ConstraintVariable::FunctionVariable, QT, N),
+    : ConstraintVariable(ConstraintVariable::FunctionVariable, QT, N, I),
       Parent(nullptr) {
   const Type *Ty = QT.getTypePtr();
   QualType RT, RTIType;
@@ -1236,9 +1240,9 @@ void FunctionVariableConstraint::equateArgumentConstraints(ProgramInfo &Info,
     // Get appropriate constraints based on whether the function is static or
     // not.
     if (IsStatic) {
-      DefnCons = Info.getStaticFuncConstraint(Name, FileName);
+      DefnCons = Info.getStaticFuncConstraint(Name.str(), FileName);
     } else {
-      DefnCons = Info.getExtFuncDefnConstraint(Name);
+      DefnCons = Info.getExtFuncDefnConstraint(Name.str());
     }
     assert(DefnCons != nullptr);
 
@@ -1566,28 +1570,23 @@ void FunctionVariableConstraint::print(raw_ostream &O) const {
   }
 }
 
-void FunctionVariableConstraint::dumpJson(raw_ostream &O) const {
-  O << "{\"FunctionVar\":{\"ReturnVar\":[";
-  bool AddComma = false;
-  ReturnVar.InternalConstraint->dumpJson(O);
-  O << ", ";
-  ReturnVar.ExternalConstraint->dumpJson(O);
-  O << "], \"name\":\"" << Name << "\", ";
-  O << "\"Parameters\":[";
-  AddComma = false;
-  for (const auto &I : ParamVars) {
-    if (AddComma) {
-      O << ",\n";
-    }
-    O << "[";
-    I.InternalConstraint->dumpJson(O);
-    O << ", ";
-    I.ExternalConstraint->dumpJson(O);
-    O << "]";
-    AddComma = true;
-  }
-  O << "]";
-  O << "}}";
+void FunctionVariableConstraint::dumpJson(llvm::json::OStream &J) const {
+  J.object([&] {
+    J.attributeObject("FunctionVar", [&] {
+      J.attributeArray("ReturnVar", [&] {
+        ReturnVar.InternalConstraint->dumpJson(J);
+        ReturnVar.ExternalConstraint->dumpJson(J);
+      });
+      J.attribute("name", Name);
+      J.attributeArray("Parameters", [&] {
+        for (const auto &I : ParamVars)
+          J.array([&] {
+            I.InternalConstraint->dumpJson(J);
+            I.ExternalConstraint->dumpJson(J);
+          });
+      });
+    });
+  });
 }
 
 bool FunctionVariableConstraint::srcHasItype() const {
@@ -1626,7 +1625,7 @@ FunctionVariableConstraint::mkString(Constraints &CS,
   UNPACK_OPTS(EmitName, ForItype, EmitPointee, UnmaskTypedef, UseName,
               ForItypeBase);
   if (UseName.empty())
-    UseName = Name;
+    UseName = Name.str();
   std::string Ret = ReturnVar.mkTypeStr(CS, false, "", ForItypeBase);
   std::string Itype = ReturnVar.mkItypeStr(CS, ForItypeBase);
   // When a function pointer type is the base for an itype, the name and
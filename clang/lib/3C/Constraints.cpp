@@ -13,8 +13,11 @@
 #include "clang/3C/3CGlobalOptions.h"
 #include "clang/3C/ConstraintVariables.h"
 #include "clang/3C/ConstraintsGraph.h"
+#include "llvm/ADT/BitVector.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ThreadPool.h"
 #include <iostream>
+#include <queue>
 #include <set>
 
 using namespace llvm;
@@ -33,6 +36,21 @@ static cl::opt<bool>
                  cl::desc("Perform only least solution for Pty Constrains."),
                  cl::init(false), cl::cat(SolverCategory));
 
+static cl::opt<unsigned> MinAtomsForParallelSolve(
+    "min-atoms-parallel-solve",
+    cl::desc("Solve the independent parts of a constraint graph on separate "
+             "threads (see -num-threads) when the graph has at least this "
+             "many atoms."),
+    cl::init(20000), cl::Hidden, cl::cat(SolverCategory));
+
+static cl::opt<bool> NoIncrementalSolve(
+    "no-incremental-solve",
+    cl::desc("Solve the constraints again from scratch after constraints "
+             "are removed instead of updating the solution in place."),
+    cl::init(false), cl::Hidden, cl::cat(SolverCategory));
+
+const unsigned Constraints::NoReason;
+
 // Remove the constraint from the global constraint set.
 bool Constraints::removeConstraint(Constraint *C) {
   bool RetVal = false;
@@ -40,8 +58,13 @@ bool Constraints::removeConstraint(Constraint *C) {
   assert(GE != nullptr && "Invalid constrains requested to be removed.");
   // We can only remove constraints from ConstAtoms.
   if (isa<ConstAtom>(GE->getRHS()) && isa<VarAtom>(GE->getLHS())) {
+    assert(!BatchOpen && "Removing a constraint while a batch is open.");
     removeReasonBasedConstraint(C);
     RetVal = TheConstraints.erase(C) != 0;
+    GeqIndexMap &Index = getGeqIndex(GE);
+    auto IndexEntry = Index.find(std::make_pair(GE->getLHS(), GE->getRHS()));
+    if (IndexEntry != Index.end() && IndexEntry->second == GE)
+      Index.erase(IndexEntry);
     // Delete from graph.
     ConstraintsGraph *TG = nullptr;
     TG = GE->constraintIsChecked() ? ChkCG : PtrTypCG;
@@ -91,30 +114,35 @@ void Constraints::editConstraintHook(Constraint *C) {
 bool Constraints::addConstraint(Constraint *C) {
   editConstraintHook(C);
 
-  auto Search = TheConstraints.find(C);
-
-  // Check if C is already in the set of constraints.
-  if (Search == TheConstraints.end()) {
+  Geq *G = dyn_cast<Geq>(C);
+  if (G == nullptr)
+    llvm_unreachable("unsupported constraint");
+
+  // Check if C is already in the set of constraints. This is a hashed lookup
+  // so that the common duplicate case never reaches the ordered set.
+  auto Search =
+      getGeqIndex(G).try_emplace(std::make_pair(G->getLHS(), G->getRHS()), G);
+  if (Search.second) {
+    unsigned ReasonId = getReasonId(C);
+    if (BatchOpen) {
+      PendingGeqs.push_back(std::make_pair(G, ReasonId));
+      return true;
+    }
     TheConstraints.insert(C);
 
-    if (Geq *G = dyn_cast<Geq>(C)) {
-      if (G->constraintIsChecked())
-        ChkCG->addConstraint(G, *this);
-      else
-        PtrTypCG->addConstraint(G, *this);
-    }
+    if (G->constraintIsChecked())
+      ChkCG->addConstraint(G, *this);
+    else
+      PtrTypCG->addConstraint(G, *this);
 
-    addReasonBasedConstraint(C);
+    addReasonBasedConstraint(C, ReasonId);
 
     // Update the variables that depend on this constraint.
-    if (Geq *E = dyn_cast<Geq>(C)) {
-      if (VarAtom *VLhs = dyn_cast<VarAtom>(E->getLHS()))
-        VLhs->Constraints.insert(C);
-      else if (VarAtom *VRhs = dyn_cast<VarAtom>(E->getRHS())) {
-        VRhs->Constraints.insert(C);
-      }
-    } else
-      llvm_unreachable("unsupported constraint");
+    if (VarAtom *VLhs = dyn_cast<VarAtom>(G->getLHS()))
+      VLhs->Constraints.insert(C);
+    else if (VarAtom *VRhs = dyn_cast<VarAtom>(G->getRHS())) {
+      VRhs->Constraints.insert(C);
+    }
     return true;
   }
 
@@ -125,29 +153,68 @@ bool Constraints::addConstraint(Constraint *C) {
   // This is needed as 3C will currently only report one cause of wildness
   // (See https://github.com/correctcomputation/checkedc-clang/issues/664)
   if (C->isUnwritable()) {
-    auto *StoredConstraint = *Search;
+    auto *StoredConstraint = Search.first->second;
     StoredConstraint->setReason(C->getReason());
   }
 
   return false;
 }
 
-bool Constraints::addReasonBasedConstraint(Constraint *C) {
-  // Only insert if this is an Eq constraint and has a valid reason.
-  if (Geq *E = dyn_cast<Geq>(C)) {
-    if (E->getReasonText() != DEFAULT_REASON && !E->getReasonText().empty() &&
-        E->getReason().Location.valid())
-      return this->ConstraintsByReason[E->getReasonText()].insert(E).second;
+void Constraints::beginConstraintBatch() {
+  assert(!BatchOpen && "Constraint batches cannot be nested.");
+  BatchOpen = true;
+}
+
+void Constraints::commitConstraintBatch() {
+  assert(BatchOpen && "Committing a constraint batch that was never begun.");
+  BatchOpen = false;
+
+  // Each graph gets its edges in the order the constraints were added, as
+  // it would from addConstraint.
+  std::vector<Geq *> NewChkGeqs, NewPtrTypGeqs;
+  for (auto &Pending : PendingGeqs) {
+    Geq *G = Pending.first;
+    (G->constraintIsChecked() ? NewChkGeqs : NewPtrTypGeqs).push_back(G);
+    TheConstraints.insert(G);
+    addReasonBasedConstraint(G, Pending.second);
+    if (VarAtom *VLhs = dyn_cast<VarAtom>(G->getLHS()))
+      VLhs->Constraints.insert(G);
+    else if (VarAtom *VRhs = dyn_cast<VarAtom>(G->getRHS()))
+      VRhs->Constraints.insert(G);
   }
-  return false;
+  ChkCG->addConstraints(NewChkGeqs, *this);
+  PtrTypCG->addConstraints(NewPtrTypGeqs, *this);
+  PendingGeqs.clear();
+}
+
+unsigned Constraints::getReasonId(Constraint *C) {
+  // Only an Eq constraint with a valid reason is listed.
+  Geq *E = dyn_cast<Geq>(C);
+  if (E == nullptr)
+    return NoReason;
+  const ReasonLoc &Rsn = E->getReason();
+  if (Rsn.Reason == DEFAULT_REASON || Rsn.Reason.empty() ||
+      !Rsn.Location.valid())
+    return NoReason;
+  auto Ins = ReasonIds.try_emplace(
+      Rsn.Reason, static_cast<unsigned>(ConstraintsByReason.size()));
+  if (Ins.second)
+    ConstraintsByReason.emplace_back();
+  return Ins.first->second;
+}
+
+bool Constraints::addReasonBasedConstraint(Constraint *C, unsigned ReasonId) {
+  if (ReasonId == NoReason)
+    return false;
+  return ConstraintsByReason[ReasonId].insert(C).second;
 }
 
 bool Constraints::removeReasonBasedConstraint(Constraint *C) {
   if (Geq *E = dyn_cast<Geq>(C)) {
     // Remove if the constraint is present.
-    if (this->ConstraintsByReason.find(E->getReasonText()) !=
-        this->ConstraintsByReason.end())
-      return this->ConstraintsByReason[E->getReasonText()].erase(E) > 0;
+    auto It = ReasonIds.find(E->getReasonText());
+    if (It != ReasonIds.end())
+      return ConstraintsByReason[It->second].erase(E) > 0;
   }
   return false;
 }
@@ -170,50 +237,201 @@ bool Constraints::removeReasonBasedConstraint(Constraint *C) {
 //---- set sol(k) := (sol(k) JOIN Q)
 //---- for all edges (k --> q) in G, confirm that sol(k) <: q; else fail
 //---- add k to W
+//
+// The worklist is ordered by the topological rank of each atom's strongly
+// connected component in the direction solutions flow, so a component is only
+// processed once every component upstream of it has its final solution. Cycles
+// of Geq constraints are then iterated over locally instead of being revisited
+// whenever an upstream solution changes. Because an atom only passes on its
+// solution once that solution changes, the atoms of a cycle need not end up
+// with the same solution (e.g., a parameter that keeps its solution across a
+// reset), so the components are used for scheduling rather than merged into a
+// single atom. The result is the same fixpoint as for any other worklist order.
+//
+// ConstAtoms keep their solution, so solutions only flow within the weakly
+// connected components of the VarAtoms (CompactConstraintsGraph::
+// getVarComponent). With -num-threads, the components of a large graph are
+// solved concurrently, each with its own worklist. A component's worklist holds
+// exactly the entries of the single worklist that belong to the component, in
+// the same order, so every atom gets the same solution as on one thread.
+//
+// CCG must be a snapshot of CG's current edges.
+namespace {
+class SolutionPropagator {
+public:
+  SolutionPropagator(const CompactConstraintsGraph &CCG, bool DoLeastSolution)
+      : CCG(CCG), DoLeastSolution(DoLeastSolution) {}
+
+  // Propagate the solutions of the ConstAtoms and of the atoms in InitVs
+  // through the graph and store the new solutions in Env.
+  void run(ConstraintsEnv &Env, std::set<VarAtom *> *InitVs);
+
+private:
+  const CompactConstraintsGraph &CCG;
+  bool DoLeastSolution;
+  // The solution of each atom, by index in CCG. Each component only writes
+  // the entries of its own VarAtoms.
+  std::vector<ConstAtom *> Sol;
+  std::vector<char> InWorkList;
+
+  typedef std::pair<unsigned, unsigned> ConstEdge;
+  // Propagate from Seeds. If ConstEdges is not null, only the VarAtoms of one
+  // component are updated: ConstEdges lists the edges from each ConstAtom to
+  // the component, grouped by ConstAtom in increasing order.
+  void propagate(ArrayRef<unsigned> Seeds, ArrayRef<ConstEdge> *ConstEdges);
+};
+} // namespace
+
+void SolutionPropagator::propagate(ArrayRef<unsigned> Seeds,
+                                   ArrayRef<ConstEdge> *ConstEdges) {
+  // Solutions flow to successors for the least solution and to predecessors
+  // for the greatest.
+  typedef std::pair<unsigned, unsigned> RankAndNode;
+  std::priority_queue<RankAndNode, std::vector<RankAndNode>,
+                      std::greater<RankAndNode>>
+      WorkList;
+  auto AddToWorkList = [&](unsigned Idx) {
+    if (InWorkList[Idx])
+      return;
+    InWorkList[Idx] = true;
+    WorkList.push({CCG.getComponentRank(Idx, DoLeastSolution), Idx});
+  };
+  // A ConstAtom is a seed at most once and is never added again, so it needs
+  // no entry in InWorkList, which the components could not share.
+  for (unsigned Idx : Seeds)
+    if (isa<ConstAtom>(CCG.getAtom(Idx)))
+      WorkList.push({CCG.getComponentRank(Idx, DoLeastSolution), Idx});
+    else
+      AddToWorkList(Idx);
 
-static bool
-doSolve(ConstraintsGraph &CG,
-        ConstraintsEnv &Env, Constraints *CS, bool DoLeastSolution,
-        std::set<VarAtom *> *InitVs,
-        std::set<ConstraintsGraph::EdgeType *> &Conflicts) {
+  std::vector<unsigned> ConstNeighbors;
+  while (!WorkList.empty()) {
+    unsigned Curr = WorkList.top().second;
+    WorkList.pop();
+    ConstAtom *CurrSol = Sol[Curr];
+    ArrayRef<unsigned> Neighbors = CCG.getNeighbors(Curr, DoLeastSolution);
+    // The neighbors of a ConstAtom can be in any component.
+    if (isa<VarAtom>(CCG.getAtom(Curr))) {
+      InWorkList[Curr] = false;
+    } else if (ConstEdges) {
+      auto Range = std::equal_range(
+          ConstEdges->begin(), ConstEdges->end(), ConstEdge(Curr, 0),
+          [](const ConstEdge &A, const ConstEdge &B) {
+            return A.first < B.first;
+          });
+      ConstNeighbors.clear();
+      for (auto It = Range.first; It != Range.second; ++It)
+        ConstNeighbors.push_back(It->second);
+      Neighbors = ConstNeighbors;
+    }
 
-  std::vector<Atom *> WorkList;
+    // update each successor's solution.
+    for (unsigned NeighborIdx : Neighbors) {
+      ConstAtom *NghSol = Sol[NeighborIdx];
+      // update solution if doing so would change it
+      // checked? --- if sol(Neighbor) <> (sol(Neighbor) JOIN Cur)
+      //   else   --- if sol(Neighbor) <> (sol(Neighbor) MEET Cur)
+      if ((DoLeastSolution && *NghSol < *CurrSol) ||
+          (!DoLeastSolution && *CurrSol < *NghSol)) {
+        // ---- set sol(k) := (sol(k) JOIN/MEET Q)
+        Sol[NeighborIdx] = CurrSol;
+        AddToWorkList(NeighborIdx);
+      }
+    }
+  }
+}
 
-  // Initialize with seeded VarAtom set (pre-solved).
+void SolutionPropagator::run(ConstraintsEnv &Env,
+                             std::set<VarAtom *> *InitVs) {
+  unsigned NumAtoms = CCG.size();
+  Sol.resize(NumAtoms);
+  for (unsigned Idx = 0; Idx < NumAtoms; Idx++)
+    Sol[Idx] = Env.getAssignment(CCG.getAtom(Idx));
+  InWorkList.assign(NumAtoms, false);
+
+  // Initialize with seeded VarAtom set (pre-solved), then with ConstAtoms.
+  // Atoms without any constraints have nothing to propagate.
+  std::vector<unsigned> Seeds;
   if (InitVs != nullptr)
-    WorkList.insert(WorkList.begin(), InitVs->begin(), InitVs->end());
-
-  // Initialize work list with ConstAtoms.
-  auto &InitC = CG.getAllConstAtoms();
-  WorkList.insert(WorkList.begin(), InitC.begin(), InitC.end());
-
-  while (!WorkList.empty()) {
-    auto *Curr = *(WorkList.begin());
-    // Remove the first element, get its solution.
-    WorkList.erase(WorkList.begin());
-    ConstAtom *CurrSol = Env.getAssignment(Curr);
+    for (VarAtom *VA : *InitVs) {
+      unsigned Idx;
+      if (CCG.findIndex(VA, Idx))
+        Seeds.push_back(Idx);
+    }
+  unsigned NumComponents = CCG.getNumVarComponents();
+  if (_3COpts.NumThreads == 1 || NumComponents < 2 ||
+      NumAtoms < MinAtomsForParallelSolve) {
+    Seeds.insert(Seeds.end(), CCG.getConstAtoms().begin(),
+                 CCG.getConstAtoms().end());
+    propagate(Seeds, nullptr);
+  } else {
+    // The ConstAtoms are visited in increasing order, so the edges of each
+    // component come out grouped as propagate expects.
+    std::vector<std::vector<unsigned>> ComponentSeeds(NumComponents);
+    std::vector<std::vector<ConstEdge>> ComponentConstEdges(NumComponents);
+    for (unsigned Idx : Seeds)
+      ComponentSeeds[CCG.getVarComponent(Idx)].push_back(Idx);
+    for (unsigned ConstIdx : CCG.getConstAtoms()) {
+      for (unsigned Idx : CCG.getNeighbors(ConstIdx, DoLeastSolution)) {
+        unsigned Comp = CCG.getVarComponent(Idx);
+        std::vector<ConstEdge> &Edges = ComponentConstEdges[Comp];
+        if (Edges.empty() || Edges.back().first != ConstIdx)
+          ComponentSeeds[Comp].push_back(ConstIdx);
+        Edges.push_back({ConstIdx, Idx});
+      }
+    }
 
-    // get its neighbors.
-    std::set<Atom *> Neighbors;
-    CG.getNeighbors(Curr, Neighbors, DoLeastSolution);
-    // update each successor's solution.
-    for (auto *NeighborA : Neighbors) {
-      if (VarAtom *Neighbor = dyn_cast<VarAtom>(NeighborA)) {
-        ConstAtom *NghSol = Env.getAssignment(Neighbor);
-        // update solution if doing so would change it
-        // checked? --- if sol(Neighbor) <> (sol(Neighbor) JOIN Cur)
-        //   else   --- if sol(Neighbor) <> (sol(Neighbor) MEET Cur)
-        if ((DoLeastSolution && *NghSol < *CurrSol) ||
-            (!DoLeastSolution && *CurrSol < *NghSol)) {
-          // ---- set sol(k) := (sol(k) JOIN/MEET Q)
-          bool Changed = Env.assign(Neighbor, CurrSol);
-          assert(Changed);
-          WorkList.push_back(Neighbor);
+    // Hand the components with something to propagate to the pool largest
+    // first, batching small ones, so that the threads finish close together.
+    std::vector<unsigned> ComponentSize(NumComponents, 0);
+    for (unsigned Idx = 0; Idx < NumAtoms; Idx++)
+      if (CCG.getVarComponent(Idx) != CompactConstraintsGraph::NoComponent)
+        ComponentSize[CCG.getVarComponent(Idx)]++;
+    std::vector<unsigned> Order;
+    for (unsigned Comp = 0; Comp < NumComponents; Comp++)
+      if (!ComponentSeeds[Comp].empty())
+        Order.push_back(Comp);
+    std::stable_sort(Order.begin(), Order.end(), [&](unsigned A, unsigned B) {
+      return ComponentSize[A] > ComponentSize[B];
+    });
+    const unsigned MinBatchAtoms = 4096;
+    ThreadPool Pool(hardware_concurrency(_3COpts.NumThreads));
+    auto Solve = [&, this](std::vector<unsigned> Batch) {
+      Pool.async([&, this, Batch] {
+        for (unsigned Comp : Batch) {
+          ArrayRef<ConstEdge> Edges = ComponentConstEdges[Comp];
+          propagate(ComponentSeeds[Comp], &Edges);
         }
-      } // ignore ConstAtoms for now; will confirm solution below
+      });
+    };
+    std::vector<unsigned> Batch;
+    unsigned BatchAtoms = 0;
+    for (unsigned Comp : Order) {
+      Batch.push_back(Comp);
+      BatchAtoms += ComponentSize[Comp];
+      if (BatchAtoms >= MinBatchAtoms) {
+        Solve(std::move(Batch));
+        Batch.clear();
+        BatchAtoms = 0;
+      }
     }
+    if (!Batch.empty())
+      Solve(std::move(Batch));
+    Pool.wait();
   }
 
+  for (unsigned Idx = 0; Idx < NumAtoms; Idx++)
+    if (auto *VA = dyn_cast<VarAtom>(CCG.getAtom(Idx)))
+      Env.assign(VA, Sol[Idx]);
+}
+
+static bool
+doSolve(ConstraintsGraph &CG, const CompactConstraintsGraph &CCG,
+        ConstraintsEnv &Env, Constraints *CS, bool DoLeastSolution,
+        std::set<VarAtom *> *InitVs,
+        std::set<ConstraintsGraph::EdgeType *> &Conflicts) {
+  SolutionPropagator(CCG, DoLeastSolution).run(Env, InitVs);
+
   // Check Upper/lower bounds hold; collect failures in conflicts set.
   std::set<ConstraintsGraph::EdgeType*> IncidentEdges;
   bool Ok = true;
@@ -278,40 +496,45 @@ void filter(VarAtomPred P, std::set<VarAtom *> &S) {
 // constraint graph, but an upper bound in the checked graph. UseConstAtoms
 // decides if constant atoms should be used in addition to the provided Concrete
 // atoms.
-static std::set<VarAtom *> findBounded(ConstraintsGraph &CG,
+static std::set<VarAtom *> findBounded(const CompactConstraintsGraph &CG,
                                        std::set<VarAtom *> *Concrete,
                                        bool Succs, bool UseConstAtoms = true) {
   std::set<VarAtom *> Bounded;
-  std::set<Atom *> Open;
+  BitVector Visited(CG.size());
+  std::vector<unsigned> Open;
+  auto AddToOpen = [&](Atom *A) {
+    unsigned Idx;
+    if (CG.findIndex(A, Idx) && !Visited[Idx]) {
+      Visited.set(Idx);
+      Open.push_back(Idx);
+    }
+  };
 
   // Initialize the open set of atoms with the provided set of fixed atoms.
   // These are the start points for a traversal of the constraint graph.
   if (Concrete != nullptr) {
-    Open.insert(Concrete->begin(), Concrete->end());
     Bounded.insert(Concrete->begin(), Concrete->end());
+    for (VarAtom *VA : *Concrete)
+      AddToOpen(VA);
   }
 
   // We often, but not always, want to consider constant atoms as concrete.
-  if (UseConstAtoms) {
-    auto &ConstA = CG.getAllConstAtoms();
-    Open.insert(ConstA.begin(), ConstA.end());
-  }
+  if (UseConstAtoms)
+    for (unsigned Idx : CG.getConstAtoms())
+      AddToOpen(CG.getAtom(Idx));
 
   // Traversal of the constraint graph. An atom is bounded in a direction by
   // one of the Concrete atoms if it is reachable from one of the atoms taking
   // only edges in that direction. The particular atom bounding it does not
   // matter.
   while (!Open.empty()) {
-    auto *Curr = *(Open.begin());
-    Open.erase(Open.begin());
-
-    std::set<Atom *> Neighbors;
-    CG.getNeighbors(Curr, Neighbors, Succs, false, true);
-    for (Atom *A : Neighbors) {
-      VarAtom *VA = dyn_cast<VarAtom>(A);
-      if (VA && Bounded.find(VA) == Bounded.end()) {
-        Open.insert(VA);
-        Bounded.insert(VA);
+    unsigned Curr = Open.back();
+    Open.pop_back();
+    for (unsigned Idx : CG.getNeighbors(Curr, Succs, true)) {
+      if (!Visited[Idx]) {
+        Visited.set(Idx);
+        Bounded.insert(cast<VarAtom>(CG.getAtom(Idx)));
+        Open.push_back(Idx);
       }
     }
   }
@@ -324,6 +547,7 @@ bool Constraints::graphBasedSolve() {
   ConstraintsGraph SolChkCG;
   ConstraintsGraph SolPtrTypCG;
   ConstraintsEnv &Env = Environment;
+  PtrTypConflictAtoms.clear();
 
   // Checked well-formedness.
   Environment.checkAssignment(getDefaultSolution());
@@ -346,11 +570,14 @@ bool Constraints::graphBasedSolve() {
   // Solve Checked/unchecked constraints first.
   Env.doCheckedSolve(true);
 
-  bool Res = doSolve(SolChkCG, Env, this, true, nullptr, Conflicts);
+  CompactConstraintsGraph CompactChkCG(SolChkCG);
+  bool Res =
+      doSolve(SolChkCG, CompactChkCG, Env, this, true, nullptr, Conflicts);
 
   // Now solve PtrType constraints
   if (Res && _3COpts.AllTypes) {
     Env.doCheckedSolve(false);
+    CompactConstraintsGraph CompactPtrTypCG(SolPtrTypCG);
     bool RegularSolve = !(OnlyGreatestSol || OnlyLeastSol);
 
     if (OnlyLeastSol) {
@@ -362,14 +589,17 @@ bool Constraints::graphBasedSolve() {
             return true;
           },
           getNTArr());
-      Res = doSolve(SolPtrTypCG, Env, this, true, nullptr, Conflicts);
+      Res = doSolve(SolPtrTypCG, CompactPtrTypCG, Env, this,
+                    true, nullptr, Conflicts);
     } else if (OnlyGreatestSol) {
       // Do only greatest solution
-      Res = doSolve(SolPtrTypCG, Env, this, false, nullptr, Conflicts);
+      Res = doSolve(SolPtrTypCG, CompactPtrTypCG, Env, this,
+                    false, nullptr, Conflicts);
     } else {
       // Regular solve
       // Step 1: Greatest solution
-      Res = doSolve(SolPtrTypCG, Env, this, false, nullptr, Conflicts);
+      Res = doSolve(SolPtrTypCG, CompactPtrTypCG, Env, this,
+                    false, nullptr, Conflicts);
     }
 
     // Step 2: Reset all solutions but for function params,
@@ -382,18 +612,18 @@ bool Constraints::graphBasedSolve() {
       // 1. Find return vars with a lower bound.
       std::set<VarAtom *> ParamVars = Env.filterAtoms(IsParam);
       std::set<VarAtom *> LowerBoundedRet =
-          findBounded(SolPtrTypCG, &ParamVars, true);
+          findBounded(CompactPtrTypCG, &ParamVars, true);
       filter(IsReturn, LowerBoundedRet);
 
       // 2. Find local vars where one of the return vars is an upper bound.
       //    Conversely, these are an alternative lower bound for the return var.
       std::set<VarAtom *> RetUpperBoundedLocals =
-          findBounded(SolPtrTypCG, &LowerBoundedRet, false, false);
+          findBounded(CompactPtrTypCG, &LowerBoundedRet, false, false);
       filter(IsNonParamReturn, RetUpperBoundedLocals);
 
       // 3. Find local vars upper bounded by a const var.
       std::set<VarAtom *> ConstUpperBoundedLocals =
-          findBounded(SolPtrTypCG, nullptr, false);
+          findBounded(CompactPtrTypCG, nullptr, false);
       filter(IsNonParamReturn, ConstUpperBoundedLocals);
 
       // 4. Take set difference of 2 and 3 to find bounded vars that do not
@@ -413,9 +643,11 @@ bool Constraints::graphBasedSolve() {
 
       // Remember which variables have a concrete lower bound. Variables without
       // a lower bound will be resolved in the final greatest solution.
-      std::set<VarAtom *> LowerBounded = findBounded(SolPtrTypCG, &Rest, true);
+      std::set<VarAtom *> LowerBounded =
+          findBounded(CompactPtrTypCG, &Rest, true);
 
-      Res = doSolve(SolPtrTypCG, Env, this, true, &Rest, Conflicts);
+      Res = doSolve(SolPtrTypCG, CompactPtrTypCG, Env, this,
+                    true, &Rest, Conflicts);
 
       // Step 3: Reset local variable solutions, compute greatest
       if (Res) {
@@ -428,7 +660,8 @@ bool Constraints::graphBasedSolve() {
             },
             getPtr());
 
-        Res = doSolve(SolPtrTypCG, Env, this, false, &Rest, Conflicts);
+        Res = doSolve(SolPtrTypCG, CompactPtrTypCG, Env, this,
+                      false, &Rest, Conflicts);
       }
     }
     // If PtrType solving (partly) failed, make the affected VarAtoms wild.
@@ -464,10 +697,13 @@ bool Constraints::graphBasedSolve() {
         addConstraint(ConflictConstraint);
         SolChkCG.addConstraint(ConflictConstraint, *this);
         Rest.insert(cast<VarAtom>(ConflictAtom));
+        PtrTypConflictAtoms.insert(ConflictAtom);
       }
       Conflicts.clear();
+      // The conflict constraints added edges to SolChkCG.
+      CompactConstraintsGraph UpdatedChkCG(SolChkCG);
       /* FIXME: Should we propagate the old res? */
-      Res = doSolve(SolChkCG, Env, this, true, &Rest, Conflicts);
+      Res = doSolve(SolChkCG, UpdatedChkCG, Env, this, true, &Rest, Conflicts);
     }
     // Final Step: Merge ptyp solution with checked solution.
     Env.mergePtrTypes();
@@ -481,11 +717,12 @@ bool Constraints::graphBasedSolve() {
 // an empty. If the system could not be solved, the constraints in conflict
 // are returned in the first position.
 void Constraints::solve() {
+  assert(!BatchOpen && "Solving while a constraint batch is open.");
   if (DebugSolver) {
     errs() << "constraints beginning solve\n";
     dump();
   }
-  graphBasedSolve();
+  LastSolveSucceeded = graphBasedSolve();
 
   if (DebugSolver) {
     errs() << "solution, when done solving\n";
@@ -493,6 +730,93 @@ void Constraints::solve() {
   }
 }
 
+// Removing a constraint can only lower the checked solutions of the atoms
+// reachable from its LHS in the checked graph; every other solution, including
+// the pointer type solutions, stays the same because the rest of the system is
+// unchanged. So the checked solutions of those atoms are reset to the least
+// solution and the solutions of the rest of the graph are propagated back into
+// them, which reaches the same fixpoint as solving from scratch.
+bool Constraints::solveAfterRemoval(const ConstraintSet &Removed) {
+  if (!LastSolveSucceeded || NoIncrementalSolve)
+    return false;
+
+  std::set<VarAtom *> Affected;
+  std::vector<VarAtom *> Open;
+  for (Constraint *C : Removed) {
+    Geq *G = dyn_cast<Geq>(C);
+    // Pointer type constraints feed the multi-step pointer type solve, which
+    // cannot be updated in place.
+    if (G == nullptr || !G->constraintIsChecked() ||
+        PtrTypConflictAtoms.count(G->getLHS()))
+      return false;
+    if (auto *VA = dyn_cast<VarAtom>(G->getLHS()))
+      if (Affected.insert(VA).second)
+        Open.push_back(VA);
+  }
+  while (!Open.empty()) {
+    VarAtom *Curr = Open.back();
+    Open.pop_back();
+    auto *N = ChkCG->findNode(Curr);
+    if (N == nullptr)
+      continue;
+    for (auto *E : N->getEdges())
+      if (auto *Succ = dyn_cast<VarAtom>(E->getTargetNode().getData()))
+        if (Affected.insert(Succ).second)
+          Open.push_back(Succ);
+  }
+
+  // After the final merge, the checked solution of a non-WILD atom holds its
+  // pointer type, so only WILD is taken from the atoms that keep their
+  // solution.
+  ConstraintsEnv &Env = Environment;
+  Env.doCheckedSolve(true);
+  auto CheckedSol = [&](Atom *A) -> ConstAtom * {
+    ConstAtom *Sol = Env.getAssignment(A);
+    if (isa<VarAtom>(A) && !isa<WildAtom>(Sol))
+      return getPtr();
+    return Sol;
+  };
+  for (VarAtom *VA : Affected)
+    Env.assign(VA, getPtr());
+  for (VarAtom *VA : Affected) {
+    auto *N = ChkCG->findNode(VA);
+    if (N == nullptr)
+      continue;
+    for (auto *E : N->getPredecessors()) {
+      Atom *Pred = E->getTargetNode().getData();
+      if (isa<VarAtom>(Pred) && Affected.count(cast<VarAtom>(Pred)))
+        continue;
+      ConstAtom *PredSol = CheckedSol(Pred);
+      if (*Env.getAssignment(VA) < *PredSol) {
+        Env.assign(VA, PredSol);
+        Open.push_back(VA);
+      }
+    }
+  }
+  // Every successor of an affected atom is affected, so propagation stays
+  // within the affected atoms.
+  while (!Open.empty()) {
+    VarAtom *Curr = Open.back();
+    Open.pop_back();
+    ConstAtom *CurrSol = Env.getAssignment(Curr);
+    for (auto *E : ChkCG->findNode(Curr)->getEdges()) {
+      auto *Succ = dyn_cast<VarAtom>(E->getTargetNode().getData());
+      if (Succ != nullptr && *Env.getAssignment(Succ) < *CurrSol) {
+        Env.assign(Succ, CurrSol);
+        Open.push_back(Succ);
+      }
+    }
+  }
+
+  // Redo the merge of the pointer type solutions for the affected atoms.
+  if (_3COpts.AllTypes)
+    for (VarAtom *VA : Affected)
+      if (!isa<WildAtom>(Env.getAssignment(VA)))
+        Env.assign(VA, getVariables().at(VA).second);
+
+  return true;
+}
+
 void Constraints::print(raw_ostream &O) const {
   O << "CONSTRAINTS: \n";
   for (const auto &C : TheConstraints) {
@@ -504,29 +828,32 @@ void Constraints::print(raw_ostream &O) const {
 
 void Constraints::dump(void) const { print(errs()); }
 
-void Constraints::dumpJson(llvm::raw_ostream &O) const {
-  O << "{\"Constraints\":[";
-  bool AddComma = false;
-  for (const auto &C : TheConstraints) {
-    if (AddComma) {
-      O << ",\n";
-    }
-    C->dumpJson(O);
-    AddComma = true;
-  }
-  O << "],\n";
+void Constraints::dumpJson(llvm::json::OStream &J) const {
+  J.object([&] {
+    J.attributeArray("Constraints", [&] {
+      for (const auto &C : TheConstraints)
+        C->dumpJson(J);
+    });
+    J.attributeBegin("Environment");
+    Environment.dumpJson(J);
+    J.attributeEnd();
+  });
+}
 
-  Environment.dumpJson(O);
+void Constraints::dumpNDJson(llvm::raw_ostream &O) const {
+  for (const auto &C : TheConstraints)
+    writeNDJsonLine(O, [C](llvm::json::OStream &J) { C->dumpJson(J); });
+  Environment.dumpNDJson(O);
 }
 
 bool Constraints::removeAllConstraintsOnReason(std::string &Reason,
                                                ConstraintSet &RemovedCons) {
   // Are there any constraints with this reason?
   bool Removed = false;
-  if (this->ConstraintsByReason.find(Reason) !=
-      this->ConstraintsByReason.end()) {
-    RemovedCons.insert(this->ConstraintsByReason[Reason].begin(),
-                       this->ConstraintsByReason[Reason].end());
+  auto It = ReasonIds.find(Reason);
+  if (It != ReasonIds.end()) {
+    RemovedCons.insert(ConstraintsByReason[It->second].begin(),
+                       ConstraintsByReason[It->second].end());
     for (auto *CToDel : RemovedCons) {
       Removed = this->removeConstraint(CToDel) || Removed;
     }
@@ -592,7 +919,14 @@ Geq *Constraints::createGeq(Atom *Lhs, Atom *Rhs, ReasonLoc Rsn,
       Rsn.Location = PersistentSourceLoc();
   }
   assert("Shouldn't be constraining WILD >= VAR" && Lhs != getWild());
-  return new Geq(Lhs, Rhs, Rsn, IsCheckedConstraint, Soft);
+  return new (GeqAllocator.Allocate()) Geq(Lhs, Rhs, Rsn, IsCheckedConstraint,
+                                           Soft);
+}
+
+Geq *Constraints::getGeq(Atom *Lhs, Atom *Rhs, bool IsCheckedConstraint) const {
+  const GeqIndexMap &Index = IsCheckedConstraint ? CheckedGeqs : PtrTypGeqs;
+  auto It = Index.find(std::make_pair(Lhs, Rhs));
+  return It != Index.end() ? It->second : nullptr;
 }
 
 void Constraints::resetEnvironment() {
@@ -641,23 +975,39 @@ void ConstraintsEnv::print(raw_ostream &O) const {
   }
 }
 
-void ConstraintsEnv::dumpJson(llvm::raw_ostream &O) const {
-  bool AddComma = false;
-  O << "\"Environment\":[";
-  for (const auto &V : Environment) {
-    if (AddComma) {
-      O << ",\n";
-    }
-    O << "{\"var\":";
-    V.first->dumpJson(O);
-    O << ", \"value:\":{\"checked\":";
-    V.second.first->dumpJson(O);
-    O << ", \"PtrType\":";
-    V.second.second->dumpJson(O);
-    O << "}}";
-    AddComma = true;
-  }
-  O << "]}";
+void ConstraintsEnv::dumpEntryJson(llvm::json::OStream &J,
+                                   const EnvironmentMap::value_type &V) {
+  J.object([&] {
+    J.attributeBegin("var");
+    V.first->dumpJson(J);
+    J.attributeEnd();
+    J.attributeObject("value:", [&] {
+      J.attributeBegin("checked");
+      V.second.first->dumpJson(J);
+      J.attributeEnd();
+      J.attributeBegin("PtrType");
+      V.second.second->dumpJson(J);
+      J.attributeEnd();
+    });
+  });
+}
+
+void ConstraintsEnv::dumpJson(llvm::json::OStream &J) const {
+  J.array([&] {
+    for (const auto &V : Environment)
+      dumpEntryJson(J, V);
+  });
+}
+
+void ConstraintsEnv::dumpNDJson(llvm::raw_ostream &O) const {
+  for (const auto &V : Environment)
+    writeNDJsonLine(O, [&V](llvm::json::OStream &J) {
+      J.object([&] {
+        J.attributeBegin("Environment");
+        dumpEntryJson(J, V);
+        J.attributeEnd();
+      });
+    });
 }
 
 VarAtom *ConstraintsEnv::getFreshVar(VarSolTy InitC, std::string Name,
@@ -674,7 +1024,7 @@ VarAtom *ConstraintsEnv::getOrCreateVar(ConstraintKey V, VarSolTy InitC,
 
   if (I != Environment.end())
     return I->first;
-  VarAtom *VA = new VarAtom(Tv);
+  VarAtom *VA = new (VarAtomAllocator.Allocate()) VarAtom(Tv);
   Environment[VA] = InitC;
   return VA;
 }
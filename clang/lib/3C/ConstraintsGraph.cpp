@@ -10,7 +10,9 @@
 //===----------------------------------------------------------------------===//
 
 #include "clang/3C/ConstraintsGraph.h"
+#include <algorithm>
 #include <iostream>
+#include <iterator>
 
 ConstraintsGraph::NodeType *ConstraintsGraph::findOrCreateNode(Atom *A) {
   // Save all the const atoms.
@@ -24,15 +26,259 @@ std::set<ConstAtom *> &ConstraintsGraph::getAllConstAtoms() {
 }
 
 void ConstraintsGraph::addConstraint(Geq *C, const Constraints &CS) {
-  Atom *A1 = C->getLHS();
-  if (auto *VA1 = clang::dyn_cast<VarAtom>(A1))
-    assert(CS.getVar(VA1->getLoc()) == VA1);
+  addConstraints(C, CS);
+}
+
+void ConstraintsGraph::addConstraints(llvm::ArrayRef<Geq *> Cs,
+                                      const Constraints &CS) {
+  for (Geq *C : Cs) {
+    Atom *A1 = C->getLHS();
+    if (auto *VA1 = clang::dyn_cast<VarAtom>(A1))
+      assert(CS.getVar(VA1->getLoc()) == VA1);
+
+    Atom *A2 = C->getRHS();
+    if (auto *VA2 = clang::dyn_cast<VarAtom>(A2))
+      assert(CS.getVar(VA2->getLoc()) == VA2);
+
+    NodeType *N2 = findOrCreateNode(A2);
+    NodeType *N1 = findOrCreateNode(A1);
+    N2->connectTo(*N1, C->isSoft(), C);
+  }
+  // The reachability cache only needs to be dropped once for the batch.
+  invalidateBFSCache();
+}
+
+// Tarjan's algorithm over the nodes 0 to N-1 with the given successor lists,
+// with an explicit stack of (node, next successor) pairs because the
+// constraint graphs can be too deep to recurse over. Sets Comp[V] to the
+// strongly connected component of V and returns the number of components.
+// Components are numbered in the order they are completed, and a component is
+// completed only after every component reachable from it.
+static unsigned findSCCs(
+    unsigned N,
+    llvm::function_ref<llvm::ArrayRef<unsigned>(unsigned)> GetSuccs,
+    std::vector<unsigned> &Comp) {
+  const unsigned Unvisited = ~0U;
+  std::vector<unsigned> DFSIndex(N, Unvisited), LowLink(N, 0);
+  Comp.assign(N, Unvisited);
+  std::vector<unsigned> Stack;
+  std::vector<std::pair<unsigned, unsigned>> DFSStack;
+  unsigned NextIndex = 0;
+  unsigned NumComps = 0;
+  for (unsigned Root = 0; Root < N; Root++) {
+    if (DFSIndex[Root] != Unvisited)
+      continue;
+    DFSIndex[Root] = LowLink[Root] = NextIndex++;
+    Stack.push_back(Root);
+    DFSStack.push_back({Root, 0});
+    while (!DFSStack.empty()) {
+      unsigned V = DFSStack.back().first;
+      llvm::ArrayRef<unsigned> VSuccs = GetSuccs(V);
+      unsigned NextSucc = DFSStack.back().second;
+      if (NextSucc < VSuccs.size()) {
+        DFSStack.back().second++;
+        unsigned W = VSuccs[NextSucc];
+        if (DFSIndex[W] == Unvisited) {
+          DFSIndex[W] = LowLink[W] = NextIndex++;
+          Stack.push_back(W);
+          DFSStack.push_back({W, 0});
+        } else if (Comp[W] == Unvisited) {
+          // W is still on the stack, so it is in the same component as V.
+          LowLink[V] = std::min(LowLink[V], DFSIndex[W]);
+        }
+        continue;
+      }
+      DFSStack.pop_back();
+      if (!DFSStack.empty()) {
+        unsigned Parent = DFSStack.back().first;
+        LowLink[Parent] = std::min(LowLink[Parent], LowLink[V]);
+      }
+      if (LowLink[V] == DFSIndex[V]) {
+        unsigned W;
+        do {
+          W = Stack.back();
+          Stack.pop_back();
+          Comp[W] = NumComps;
+        } while (W != V);
+        NumComps++;
+      }
+    }
+  }
+  return NumComps;
+}
+
+void ConstraintsGraph::visitReachingRoots(
+    llvm::ArrayRef<Atom *> Roots,
+    llvm::function_ref<void(Atom *, llvm::ArrayRef<unsigned>)> Fn) const {
+  const unsigned Unvisited = ~0U;
+  // Number the nodes reachable from the roots, remembering which root (if any)
+  // each of them is.
+  std::vector<NodeType *> Nodes;
+  std::vector<unsigned> NodeRoot;
+  llvm::DenseMap<NodeType *, unsigned> Index;
+  for (unsigned R = 0; R < Roots.size(); R++) {
+    NodeType *N = this->findNode(Roots[R]);
+    if (N == nullptr)
+      continue;
+    auto Ins = Index.try_emplace(N, Nodes.size());
+    if (Ins.second) {
+      Nodes.push_back(N);
+      NodeRoot.push_back(R);
+    }
+  }
+  std::vector<unsigned> Succs;
+  std::vector<unsigned> Offsets;
+  for (unsigned I = 0; I < Nodes.size(); I++) {
+    Offsets.push_back(Succs.size());
+    for (auto *E : Nodes[I]->getEdges()) {
+      NodeType *Target = &E->getTargetNode();
+      auto Ins = Index.try_emplace(Target, Nodes.size());
+      if (Ins.second) {
+        Nodes.push_back(Target);
+        NodeRoot.push_back(Unvisited);
+      }
+      Succs.push_back(Ins.first->second);
+    }
+  }
+  Offsets.push_back(Succs.size());
+  unsigned N = Nodes.size();
+  auto GetSuccs = [&](unsigned I) {
+    return llvm::makeArrayRef(Succs.data() + Offsets[I],
+                              Offsets[I + 1] - Offsets[I]);
+  };
+
+  // Find the strongly connected components. Members holds the nodes of each
+  // component contiguously, in the order the components are completed.
+  std::vector<unsigned> Comp;
+  unsigned NumComps = findSCCs(N, GetSuccs, Comp);
+  std::vector<unsigned> CompStart(NumComps + 1, 0);
+  for (unsigned V = 0; V < N; V++)
+    CompStart[Comp[V] + 1]++;
+  for (unsigned C = 0; C < NumComps; C++)
+    CompStart[C + 1] += CompStart[C];
+  std::vector<unsigned> Members(N);
+  std::vector<unsigned> NextMember(CompStart.begin(), CompStart.end() - 1);
+  for (unsigned V = 0; V < N; V++)
+    Members[NextMember[Comp[V]]++] = V;
+
+  // A component is completed only after every component reachable from it, so
+  // visiting them in reverse completion order sees every component after all
+  // the components that reach it. The labels of a component are final once it
+  // is visited, so they are pushed to its successors and then released.
+  std::vector<std::vector<unsigned>> Labels(NumComps);
+  std::vector<unsigned> Merged;
+  for (unsigned C = Labels.size(); C-- > 0;) {
+    std::vector<unsigned> &Label = Labels[C];
+    auto CompMembers = llvm::makeArrayRef(Members.data() + CompStart[C],
+                                          CompStart[C + 1] - CompStart[C]);
+    for (unsigned V : CompMembers)
+      if (NodeRoot[V] != Unvisited)
+        Label.push_back(NodeRoot[V]);
+    llvm::sort(Label);
+    Label.erase(std::unique(Label.begin(), Label.end()), Label.end());
+    for (unsigned V : CompMembers) {
+      Fn(Nodes[V]->getData(), Label);
+      for (unsigned W : GetSuccs(V)) {
+        if (Comp[W] == C)
+          continue;
+        std::vector<unsigned> &SuccLabel = Labels[Comp[W]];
+        Merged.clear();
+        std::set_union(SuccLabel.begin(), SuccLabel.end(), Label.begin(),
+                       Label.end(), std::back_inserter(Merged));
+        SuccLabel.swap(Merged);
+      }
+    }
+    std::vector<unsigned>().swap(Label);
+  }
+}
 
-  Atom *A2 = C->getRHS();
-  if (auto *VA2 = clang::dyn_cast<VarAtom>(A2))
-    assert(CS.getVar(VA2->getLoc()) == VA2);
+CompactConstraintsGraph::CompactConstraintsGraph(ConstraintsGraph &CG) {
+  for (auto *N : CG) {
+    Atom *A = N->getData();
+    Index[A] = Atoms.size();
+    if (clang::isa<ConstAtom>(A))
+      ConstAtoms.push_back(Atoms.size());
+    Atoms.push_back(A);
+  }
+  buildAdjacency(CG, true, Succs);
+  buildAdjacency(CG, false, Preds);
+  rankComponents();
+  findVarComponents();
+}
+
+void CompactConstraintsGraph::buildAdjacency(ConstraintsGraph &CG, bool Succ,
+                                             Adjacency &Adj) {
+  Adj.Offsets.reserve(Atoms.size() + 1);
+  Adj.HardEnd.reserve(Atoms.size());
+  for (auto *N : CG) {
+    Adj.Offsets.push_back(Adj.Targets.size());
+    const auto &Edges = Succ ? N->getEdges() : N->getPredecessors();
+    for (bool Soft : {false, true}) {
+      for (auto *E : Edges) {
+        Atom *Target = E->getTargetNode().getData();
+        if (E->IsSoft == Soft && clang::isa<VarAtom>(Target))
+          Adj.Targets.push_back(Index[Target]);
+      }
+      if (!Soft)
+        Adj.HardEnd.push_back(Adj.Targets.size());
+    }
+  }
+  Adj.Offsets.push_back(Adj.Targets.size());
+}
 
-  addEdge(A2, A1, C->isSoft(), C);
+bool CompactConstraintsGraph::findIndex(Atom *A, unsigned &Idx) const {
+  auto It = Index.find(A);
+  if (It == Index.end())
+    return false;
+  Idx = It->second;
+  return true;
+}
+
+llvm::ArrayRef<unsigned>
+CompactConstraintsGraph::getNeighbors(unsigned Idx, bool Succ,
+                                      bool IgnoreSoftEdges) const {
+  const Adjacency &Adj = Succ ? Succs : Preds;
+  unsigned Begin = Adj.Offsets[Idx];
+  unsigned End = IgnoreSoftEdges ? Adj.HardEnd[Idx] : Adj.Offsets[Idx + 1];
+  return llvm::makeArrayRef(Adj.Targets.data() + Begin, End - Begin);
+}
+
+// Rank the strongly connected components of the successor lists so that every
+// component is ranked after the components that reach it.
+void CompactConstraintsGraph::rankComponents() {
+  NumComponents = findSCCs(
+      Atoms.size(), [this](unsigned V) { return getNeighbors(V, true); },
+      Rank);
+  // A component is completed only after every component reachable from it, so
+  // reverse the completion order.
+  for (unsigned &R : Rank)
+    R = NumComponents - 1 - R;
+}
+
+const unsigned CompactConstraintsGraph::NoComponent;
+
+// A search over both neighbor lists, which only hold VarAtoms, from each
+// VarAtom not yet in a component.
+void CompactConstraintsGraph::findVarComponents() {
+  VarComponent.assign(Atoms.size(), NoComponent);
+  std::vector<unsigned> Open;
+  for (unsigned Root = 0; Root < Atoms.size(); Root++) {
+    if (VarComponent[Root] != NoComponent || clang::isa<ConstAtom>(Atoms[Root]))
+      continue;
+    VarComponent[Root] = NumVarComponents;
+    Open.push_back(Root);
+    while (!Open.empty()) {
+      unsigned V = Open.back();
+      Open.pop_back();
+      for (bool Succ : {true, false})
+        for (unsigned W : getNeighbors(V, Succ))
+          if (VarComponent[W] == NoComponent) {
+            VarComponent[W] = NumVarComponents;
+            Open.push_back(W);
+          }
+    }
+    NumVarComponents++;
+  }
 }
 
 std::string llvm::DOTGraphTraits<GraphVizOutputGraph>::getNodeLabel(
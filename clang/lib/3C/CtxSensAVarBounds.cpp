@@ -11,6 +11,7 @@
 //
 //===----------------------------------------------------------------------===//
 #include "clang/3C/CtxSensAVarBounds.h"
+#include "clang/3C/3CGlobalOptions.h"
 #include "clang/3C/AVarBoundsInfo.h"
 #include "clang/3C/ConstraintResolver.h"
 #include "clang/3C/ProgramInfo.h"
@@ -81,46 +82,144 @@ void CtxSensitiveBoundsKeyHandler::insertCtxSensBoundsKey(
 }
 
 void CtxSensitiveBoundsKeyHandler::createCtxSensBoundsKey(
-    BoundsKey OK, const ProgramVarScope *NPS,
-    std::map<BoundsKey, BoundsKey> &CBMap) {
+    BoundsKey OK, const ProgramVarScope *NPS, CtxId Ctx) {
   ProgramVar *CKVar = ABI->getProgramVar(OK);
-  if (CBMap.find(OK) == CBMap.end()) {
+  auto Ins = CtxKeys.insert({{Ctx, OK}, 0});
+  if (Ins.second) {
     BoundsKey NK = ++(ABI->BCount);
     insertCtxSensBoundsKey(CKVar, NK, NPS);
-    CBMap[OK] = NK;
+    Ins.first->second = NK;
     // Next duplicate the Bounds information.
     BoundsPriority TP = Invalid;
     ABounds *CKBounds = ABI->getBounds(OK, Invalid, &TP);
     if (CKBounds != nullptr) {
       BoundsKey NBK = CKBounds->getBKey();
-      if (CBMap.find(NBK) == CBMap.end()) {
+      auto BIns = CtxKeys.insert({{Ctx, NBK}, 0});
+      if (BIns.second) {
         BoundsKey TmpBK = ++(ABI->BCount);
-        CBMap[NBK] = TmpBK;
+        BIns.first->second = TmpBK;
         insertCtxSensBoundsKey(CKVar, TmpBK, NPS);
       }
-      CKBounds = CKBounds->makeCopy(CBMap[NBK]);
+      CKBounds = CKBounds->makeCopy(BIns.first->second);
       ABI->replaceBounds(NK, TP, CKBounds);
     }
   }
 }
 
+bool CtxSensitiveBoundsKeyHandler::tryGetCtxKey(CtxId Ctx, BoundsKey BK,
+                                                BoundsKey &CSKey) const {
+  auto It = CtxKeys.find({Ctx, BK});
+  if (It == CtxKeys.end())
+    return false;
+  CSKey = It->second;
+  return true;
+}
+
+bool CtxSensitiveBoundsKeyHandler::getCallSignature(
+    CallExpr *CE, ASTContext *C, std::vector<BoundsKey> &Sig) {
+  for (Expr *Arg : CE->arguments()) {
+    // Member accesses have context-sensitive keys of their own, so only
+    // variables and constants identify the values that flow into the callee.
+    Expr *E = Arg->IgnoreParenCasts();
+    auto *DRE = dyn_cast<DeclRefExpr>(E);
+    bool IsVar = DRE != nullptr && isa<VarDecl>(DRE->getDecl());
+    BoundsKey ArgKey;
+    if ((!IsVar && !E->isIntegerConstantExpr(*C)) ||
+        !ABI->tryGetVariable(E, *C, ArgKey))
+      return false;
+    Sig.push_back(ArgKey);
+  }
+  return true;
+}
+
+bool CtxSensitiveBoundsKeyHandler::getCallCtx(CallExpr *CE,
+                                              const FVConstraint *FV,
+                                              ASTContext *C, CtxId &Ctx) {
+  auto PSL = PersistentSourceLoc::mkPSL(CE, *C);
+  auto It = CallSiteCtx.find(PSL);
+  if (It != CallSiteCtx.end()) {
+    Ctx = It->second;
+    return true;
+  }
+
+  // Two calls with the same callee and the same arguments only differ in where
+  // the return value goes, so they can share a context if the return value
+  // has no bounds key.
+  std::vector<BoundsKey> Sig;
+  bool Mergeable = FV != nullptr && !FV->getExternalReturn()->hasBoundsKey() &&
+                   getCallSignature(CE, C, Sig);
+  if (Mergeable) {
+    auto SigIt = CallCtxBySignature.find({FV, Sig});
+    if (SigIt != CallCtxBySignature.end()) {
+      Ctx = SigIt->second;
+      CallSiteCtx[PSL] = Ctx;
+      NumMerged++;
+      return true;
+    }
+  }
+
+  unsigned &NumCtx = CtxPerCallee[FV];
+  if (_3COpts.MaxCtxPerCallee != 0 && NumCtx >= _3COpts.MaxCtxPerCallee) {
+    NumCapped++;
+    return false;
+  }
+  NumCtx++;
+  Ctx = NextCtx++;
+  CallSiteCtx[PSL] = Ctx;
+  if (Mergeable)
+    CallCtxBySignature[{FV, Sig}] = Ctx;
+  return true;
+}
+
+bool CtxSensitiveBoundsKeyHandler::getStructCtx(const std::string &SName,
+                                                const std::string &AK,
+                                                bool IsGlobal, bool Create,
+                                                CtxId &Ctx) {
+  llvm::StringMap<CtxId> &StructCtx =
+      IsGlobal ? GlobalStructCtx : LocalStructCtx;
+  auto It = StructCtx.find(AK);
+  if (It != StructCtx.end()) {
+    Ctx = It->second;
+    return true;
+  }
+  if (!Create)
+    return false;
+
+  unsigned &NumCtx = CtxPerStruct[SName];
+  if (_3COpts.MaxCtxPerCallee != 0 && NumCtx >= _3COpts.MaxCtxPerCallee) {
+    NumCapped++;
+    return false;
+  }
+  NumCtx++;
+  Ctx = NextCtx++;
+  StructCtx[AK] = Ctx;
+  return true;
+}
+
 // Here, we create a new BoundsKey for every BoundsKey var that is related to
 // any ConstraintVariable in CSet and store the information by the
-// corresponding call expression (CE).
+// context of the corresponding call expression (CE).
 void CtxSensitiveBoundsKeyHandler::contextualizeCVar(CallExpr *CE,
                                                      const CVarSet &CSet,
                                                      ASTContext *C) {
   for (auto *CV : CSet) {
+    CtxId Ctx;
     // If this is a FV Constraint then contextualize its returns and
     // parameters.
+    std::vector<PVConstraint *> PVs;
     if (FVConstraint *FV = dyn_cast_or_null<FVConstraint>(CV)) {
-      contextualizeCVar(CE, {FV->getExternalReturn()}, C);
-      for (unsigned I = 0; I < FV->numParams(); I++) {
-        contextualizeCVar(CE, {FV->getExternalParam(I)}, C);
-      }
+      if (!getCallCtx(CE, FV, C, Ctx))
+        continue;
+      PVs.push_back(FV->getExternalReturn());
+      for (unsigned I = 0; I < FV->numParams(); I++)
+        PVs.push_back(FV->getExternalParam(I));
+    } else if (PVConstraint *PV = dyn_cast_or_null<PVConstraint>(CV)) {
+      if (!getCallCtx(CE, nullptr, C, Ctx))
+        continue;
+      PVs.push_back(PV);
     }
 
-    if (PVConstraint *PV = dyn_cast_or_null<PVConstraint>(CV)) {
+    for (PVConstraint *PV : PVs) {
       if (PV->hasBoundsKey()) {
         // First duplicate the bounds key.
         BoundsKey CK = PV->getBoundsKey();
@@ -131,33 +230,19 @@ void CtxSensitiveBoundsKeyHandler::contextualizeCVar(CallExpr *CE,
         const CtxFunctionArgScope *CFAS = nullptr;
         if (auto *FPS =
                 dyn_cast_or_null<FunctionParamScope>(CKVar->getScope())) {
-          CFAS = CtxFunctionArgScope::getCtxFunctionParamScope(FPS, CEPSL);
+          CFAS = ABI->getScopes().getCtxFunctionParamScope(FPS, CEPSL);
         }
-
-        auto PSL = PersistentSourceLoc::mkPSL(CE, *C);
-        auto &BKeyMap = CSBoundsKey[PSL];
-        createCtxSensBoundsKey(CK, CFAS, BKeyMap);
+        createCtxSensBoundsKey(CK, CFAS, Ctx);
       }
     }
   }
 }
 
-CtxStKeyMap *CtxSensitiveBoundsKeyHandler::getCtxStKeyMap(MemberExpr *ME,
-                                                          ASTContext *C) {
+bool CtxSensitiveBoundsKeyHandler::isGlobalAccess(MemberExpr *ME,
+                                                  ASTContext *C) {
   StructAccessVisitor SKV(C);
   SKV.TraverseStmt(ME->getBase()->getExprStmt());
-  CtxStKeyMap *MECSMap = getCtxStKeyMap(SKV.isGlobal());
-  return MECSMap;
-}
-
-CtxStKeyMap *CtxSensitiveBoundsKeyHandler::getCtxStKeyMap(bool IsGlobal) {
-  CtxStKeyMap *MECSMap = nullptr;
-  if (IsGlobal) {
-    MECSMap = &GlobalMEBoundsKey;
-  } else {
-    MECSMap = &LocalMEBoundsKey;
-  }
-  return MECSMap;
+  return SKV.isGlobal();
 }
 
 std::string CtxSensitiveBoundsKeyHandler::getCtxStructKey(MemberExpr *ME,
@@ -167,10 +252,11 @@ std::string CtxSensitiveBoundsKeyHandler::getCtxStructKey(MemberExpr *ME,
   return SKV.getStructAccessKey();
 }
 bool CtxSensitiveBoundsKeyHandler::tryGetFieldCSKey(
-    FieldDecl *FD, CtxStKeyMap *CSK, const std::string &AK, ASTContext *C,
+    FieldDecl *FD, bool IsGlobal, const std::string &AK, ASTContext *C,
     ProgramInfo &I, BoundsKey &CSKey) {
-  bool RetVal = false;
-  if (ABI->isValidBoundVariable(FD) && CSK->find(AK) != CSK->end()) {
+  CtxId Ctx;
+  if (ABI->isValidBoundVariable(FD) &&
+      getStructCtx("", AK, IsGlobal, false, Ctx)) {
     CVarOption CV = I.getVariable(FD, C);
     BoundsKey OrigK;
     if (CV.hasValue() && CV.getValue().hasBoundsKey()) {
@@ -178,13 +264,9 @@ bool CtxSensitiveBoundsKeyHandler::tryGetFieldCSKey(
     } else {
       OrigK = ABI->getVariable(FD);
     }
-    auto &BKeyMap = (*CSK)[AK];
-    if (BKeyMap.find(OrigK) != BKeyMap.end()) {
-      CSKey = BKeyMap[OrigK];
-      RetVal = true;
-    }
+    return tryGetCtxKey(Ctx, OrigK, CSKey);
   }
-  return RetVal;
+  return false;
 }
 
 bool CtxSensitiveBoundsKeyHandler::tryGetMECSKey(MemberExpr *ME, ASTContext *C,
@@ -193,17 +275,17 @@ bool CtxSensitiveBoundsKeyHandler::tryGetMECSKey(MemberExpr *ME, ASTContext *C,
   bool RetVal = false;
   FieldDecl *FD = dyn_cast_or_null<FieldDecl>(ME->getMemberDecl());
   if (FD != nullptr) {
-    // Check which map to insert?
-    CtxStKeyMap *MECSMap = getCtxStKeyMap(ME, C);
+    // Check which map to look in?
+    bool IsGlobal = isGlobalAccess(ME, C);
     std::string AK = getCtxStructKey(ME, C);
-    RetVal = tryGetFieldCSKey(FD, MECSMap, AK, C, I, CSKey);
+    RetVal = tryGetFieldCSKey(FD, IsGlobal, AK, C, I, CSKey);
   }
   return RetVal;
 }
 
 void CtxSensitiveBoundsKeyHandler::contextualizeStructRecord(
     ProgramInfo &I, ASTContext *C, const RecordDecl *RD, const std::string &AK,
-    std::map<BoundsKey, BoundsKey> &BKMap, bool IsGlobal) {
+    CtxId Ctx, bool IsGlobal) {
   // Create context-sensitive keys for all fields.
   for (auto *CFD : RD->fields()) {
     // There is no context-sensitive key already created for this?
@@ -219,9 +301,9 @@ void CtxSensitiveBoundsKeyHandler::contextualizeStructRecord(
     // Create a context sensitive struct scope.
     const CtxStructScope *CSS = nullptr;
     if (auto *SS = dyn_cast_or_null<StructScope>(SPV->getScope())) {
-      CSS = CtxStructScope::getCtxStructScope(SS, AK, IsGlobal);
+      CSS = ABI->getScopes().getCtxStructScope(SS, AK, IsGlobal);
     }
-    createCtxSensBoundsKey(MEBKey, CSS, BKMap);
+    createCtxSensBoundsKey(MEBKey, CSS, Ctx);
   }
 }
 
@@ -231,12 +313,10 @@ void CtxSensitiveBoundsKeyHandler::contextualizeCVar(RecordDecl *RD,
                                                      ASTContext *C,
                                                      ProgramInfo &I) {
   std::string FileName = PersistentSourceLoc::mkPSL(RD, *C).getFileName();
-  if (canWrite(FileName)) {
-    // Context sensitive struct key map.
-    CtxStKeyMap *MECSMap = getCtxStKeyMap(IsGlobal);
-    auto &BKeyMap = (*MECSMap)[AccessKey];
-    contextualizeStructRecord(I, C, RD, AccessKey, BKeyMap, IsGlobal);
-  }
+  CtxId Ctx;
+  if (canWrite(FileName) &&
+      getStructCtx(RD->getNameAsString(), AccessKey, IsGlobal, true, Ctx))
+    contextualizeStructRecord(I, C, RD, AccessKey, Ctx, IsGlobal);
 }
 
 void CtxSensitiveBoundsKeyHandler::contextualizeCVar(MemberExpr *ME,
@@ -265,12 +345,10 @@ void CtxSensitiveBoundsKeyHandler::contextualizeCVar(VarDecl *VD, ASTContext *C,
 
 BoundsKey CtxSensitiveBoundsKeyHandler::getCtxSensCEBoundsKey(
     const PersistentSourceLoc &PSL, BoundsKey BK) {
-  if (CSBoundsKey.find(PSL) != CSBoundsKey.end()) {
-    auto &TmpMap = CSBoundsKey[PSL];
-    if (TmpMap.find(BK) != TmpMap.end()) {
-      return TmpMap[BK];
-    }
-  }
+  auto It = CallSiteCtx.find(PSL);
+  BoundsKey CSKey;
+  if (It != CallSiteCtx.end() && tryGetCtxKey(It->second, BK, CSKey))
+    return CSKey;
   return BK;
 }
 
@@ -363,7 +441,6 @@ bool ContextSensitiveBoundsKeyVisitor::VisitDeclStmt(DeclStmt *DS) {
           // to various fields of the structure variable.
           const RecordDecl *Definition =
               ILE->getType()->getAsStructureType()->getDecl()->getDefinition();
-          auto *CSKeyMap = CSBHandler.getCtxStKeyMap(SAV.isGlobal());
           unsigned int InitIdx = 0;
           const auto Fields = Definition->fields();
           for (auto It = Fields.begin();
@@ -372,7 +449,7 @@ bool ContextSensitiveBoundsKeyVisitor::VisitDeclStmt(DeclStmt *DS) {
             Expr *InitExpr = ILE->getInit(InitIdx);
             BoundsKey FKey;
             // Handle assignment to context-sensitive field key.
-            if (CSBHandler.tryGetFieldCSKey(*It, CSKeyMap,
+            if (CSBHandler.tryGetFieldCSKey(*It, SAV.isGlobal(),
                                             SAV.getStructAccessKey(), Context,
                                             Info, FKey)) {
 
@@ -147,7 +147,11 @@ void DeclRewriter::rewriteDecls(ASTContext &Context, ProgramInfo &Info,
   for (const auto &I : Info.getVarMap())
     Keys.insert(I.first);
   MappingVisitor MV(Keys, Context);
+  // The entries for an earlier translation unit are not needed any more, and
+  // its AST may since have been freed (-max-resident-asts, -server).
   LastRecordDecl = nullptr;
+  VDToRDMap.clear();
+  InlineVarDecls.clear();
   for (const auto &D : TUD->decls()) {
     MV.TraverseDecl(D);
     detectInlineStruct(D, Context.getSourceManager());
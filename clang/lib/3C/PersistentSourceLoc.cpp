@@ -10,10 +10,34 @@
 
 #include "clang/3C/PersistentSourceLoc.h"
 #include "clang/3C/Utils.h"
+#include <mutex>
 
 using namespace clang;
 using namespace llvm;
 
+// The interned file names of each ASTContext registered with cacheFileNames,
+// keyed by FileEntry or, for a location without one, by the presumed file
+// name owned by the SourceManager. The caches are shared by every
+// _3CInterface in the process, so all accesses hold FileNameCacheMutex.
+typedef DenseMap<const void *, StringRef> FileNameCache;
+static DenseMap<const ASTContext *, std::unique_ptr<FileNameCache>>
+    FileNameCaches;
+static std::mutex FileNameCacheMutex;
+
+void PersistentSourceLoc::cacheFileNames(const ASTContext &Context) {
+  std::lock_guard<std::mutex> Lock(FileNameCacheMutex);
+  auto &Cache = FileNameCaches[&Context];
+  if (Cache)
+    return;
+  Cache = std::make_unique<FileNameCache>();
+  Context.AddDeallocation(
+      [](void *C) {
+        std::lock_guard<std::mutex> Lock(FileNameCacheMutex);
+        FileNameCaches.erase(static_cast<ASTContext *>(C));
+      },
+      const_cast<ASTContext *>(&Context));
+}
+
 // Given a Decl, look up the source location for that Decl and create a
 // PersistentSourceLoc that represents the location of the Decl.
 // This currently the expansion location for the declarations source location.
@@ -64,12 +88,32 @@ PersistentSourceLoc PersistentSourceLoc::mkPSL(clang::SourceRange SR,
       EndCol = EFESL.getExpansionColumnNumber();
     }
   }
-  std::string Fn = PL.getFilename();
 
-  // Get the absolute filename of the file.
+  // Get the absolute filename of the file. It only depends on the FileEntry,
+  // or on the presumed file name if there is none, so it is looked up in the
+  // cache of the ASTContext when there is one.
   FullSourceLoc TFSL(SR.getBegin(), SM);
+  const FileEntry *Fe =
+      TFSL.isValid() ? SM.getFileEntryForID(TFSL.getFileID()) : nullptr;
+  const void *CacheKey = Fe ? static_cast<const void *>(Fe)
+                            : static_cast<const void *>(PL.getFilename());
+  bool Cached = false;
+  if (TFSL.isValid()) {
+    std::lock_guard<std::mutex> Lock(FileNameCacheMutex);
+    auto CacheIt = FileNameCaches.find(&Context);
+    if (CacheIt != FileNameCaches.end()) {
+      Cached = true;
+      FileNameCache &Cache = *CacheIt->second;
+      auto NameIt = Cache.find(CacheKey);
+      if (NameIt != Cache.end())
+        return PersistentSourceLoc(NameIt->second,
+                                   FESL.getExpansionLineNumber(),
+                                   FESL.getExpansionColumnNumber(), EndCol);
+    }
+  }
+
+  std::string Fn = PL.getFilename();
   if (TFSL.isValid()) {
-    const FileEntry *Fe = SM.getFileEntryForID(TFSL.getFileID());
     std::string FeAbsS = Fn;
     if (Fe != nullptr) {
       // Unlike in `emit` in RewriteUtils.cpp, we don't re-canonicalize the file
@@ -81,7 +125,16 @@ PersistentSourceLoc PersistentSourceLoc::mkPSL(clang::SourceRange SR,
     }
     Fn = std::string(sys::path::remove_leading_dotslash(FeAbsS));
   }
-  PersistentSourceLoc PSL(Fn, FESL.getExpansionLineNumber(),
+  StringRef Name = internString(Fn);
+  // The name is computed without the lock held so that other threads are not
+  // blocked on the real path lookup; the map may have been rehashed since.
+  if (Cached) {
+    std::lock_guard<std::mutex> Lock(FileNameCacheMutex);
+    auto CacheIt = FileNameCaches.find(&Context);
+    if (CacheIt != FileNameCaches.end())
+      (*CacheIt->second)[CacheKey] = Name;
+  }
+  PersistentSourceLoc PSL(Name, FESL.getExpansionLineNumber(),
                           FESL.getExpansionColumnNumber(), EndCol);
 
   return PSL;
@@ -45,44 +45,38 @@ void dumpStaticFuncMap(const ProgramInfo::StaticFunctionMapType &EMap,
   }
 }
 
-void dumpExtFuncMapJson(const ProgramInfo::ExternalFunctionMapType &EMap,
-                        raw_ostream &O) {
-  bool AddComma = false;
-  for (const auto &DefM : EMap) {
-    if (AddComma) {
-      O << ",\n";
-    }
-    O << "{\"FuncName\":\"" << DefM.first << "\", \"Constraints\":[";
-    DefM.second->dumpJson(O);
-    O << "]}";
-    AddComma = true;
-  }
+static void
+dumpExtFuncJson(const ProgramInfo::ExternalFunctionMapType::value_type &DefM,
+                llvm::json::OStream &J) {
+  J.object([&] {
+    J.attribute("FuncName", DefM.first);
+    J.attributeArray("Constraints", [&] { DefM.second->dumpJson(J); });
+  });
 }
 
-void dumpStaticFuncMapJson(const ProgramInfo::StaticFunctionMapType &EMap,
-                           raw_ostream &O) {
-  bool AddComma = false;
-  for (const auto &DefM : EMap) {
-    if (AddComma) {
-      O << ",\n";
-    }
-    // The `FuncName` and `FileName` field names are backwards: this is actually
-    // the file name, hence the need to defend against special characters.
-    O << "{\"FuncName\":" << llvm::json::Value(DefM.first)
-      << ", \"Constraints\":[";
-    bool AddComma1 = false;
-    for (const auto &J : DefM.second) {
-      if (AddComma1) {
-        O << ",";
-      }
-      O << "{\"FileName\":\"" << J.first << "\", \"FVConstraints\":[";
-      J.second->dumpJson(O);
-      O << "]}\n";
-      AddComma1 = true;
-    }
-    O << "]}";
-    AddComma = true;
-  }
+static void
+dumpStaticFuncJson(const ProgramInfo::StaticFunctionMapType::value_type &DefM,
+                   llvm::json::OStream &J) {
+  // The `FuncName` and `FileName` field names are backwards: the outer key is
+  // actually the file name.
+  J.object([&] {
+    J.attribute("FuncName", DefM.first);
+    J.attributeArray("Constraints", [&] {
+      for (const auto &F : DefM.second)
+        J.object([&] {
+          J.attribute("FileName", F.first);
+          J.attributeArray("FVConstraints", [&] { F.second->dumpJson(J); });
+        });
+    });
+  });
+}
+
+static void dumpVariableJson(const VariableMap::value_type &I,
+                             llvm::json::OStream &J) {
+  J.object([&] {
+    J.attribute("line", I.first.toString());
+    J.attributeArray("Variables", [&] { I.second->dumpJson(J); });
+  });
 }
 
 void ProgramInfo::print(raw_ostream &O) const {
@@ -105,30 +99,47 @@ void ProgramInfo::print(raw_ostream &O) const {
 }
 
 void ProgramInfo::dumpJson(llvm::raw_ostream &O) const {
-  O << "{\"Setup\":";
-  CS.dumpJson(O);
-  // Dump the constraint variables.
-  O << ", \"ConstraintVariables\":[";
-  bool AddComma = false;
-  for (const auto &I : Variables) {
-    if (AddComma) {
-      O << ",\n";
-    }
-    PersistentSourceLoc L = I.first;
+  llvm::json::OStream J(O);
+  J.object([&] {
+    J.attributeBegin("Setup");
+    CS.dumpJson(J);
+    J.attributeEnd();
+    J.attributeArray("ConstraintVariables", [&] {
+      for (const auto &I : Variables)
+        dumpVariableJson(I, J);
+    });
+    J.attributeArray("ExternalFunctionDefinitions", [&] {
+      for (const auto &DefM : ExternalFunctionFVCons)
+        dumpExtFuncJson(DefM, J);
+    });
+    J.attributeArray("StaticFunctionDefinitions", [&] {
+      for (const auto &DefM : StaticFunctionFVCons)
+        dumpStaticFuncJson(DefM, J);
+    });
+  });
+}
 
-    O << "{\"line\":";
-    O << llvm::json::Value(L.toString());
-    O << ",\"Variables\":[";
-    I.second->dumpJson(O);
-    O << "]}";
-    AddComma = true;
-  }
-  O << "]";
-  O << ", \"ExternalFunctionDefinitions\":[";
-  dumpExtFuncMapJson(ExternalFunctionFVCons, O);
-  O << "], \"StaticFunctionDefinitions\":[";
-  dumpStaticFuncMapJson(StaticFunctionFVCons, O);
-  O << "]}";
+void ProgramInfo::dumpNDJson(llvm::raw_ostream &O) const {
+  CS.dumpNDJson(O);
+  auto WriteRecord = [&O](StringRef Kind, auto DumpValue) {
+    writeNDJsonLine(O, [&](llvm::json::OStream &J) {
+      J.object([&] {
+        J.attributeBegin(Kind);
+        DumpValue(J);
+        J.attributeEnd();
+      });
+    });
+  };
+  for (const auto &I : Variables)
+    WriteRecord("ConstraintVariables",
+                [&I](llvm::json::OStream &J) { dumpVariableJson(I, J); });
+  for (const auto &DefM : ExternalFunctionFVCons)
+    WriteRecord("ExternalFunctionDefinitions",
+                [&DefM](llvm::json::OStream &J) { dumpExtFuncJson(DefM, J); });
+  for (const auto &DefM : StaticFunctionFVCons)
+    WriteRecord("StaticFunctionDefinitions", [&DefM](llvm::json::OStream &J) {
+      dumpStaticFuncJson(DefM, J);
+    });
 }
 
 // Given a ConstraintVariable V, retrieve all of the unique
@@ -211,26 +222,35 @@ void ProgramInfo::printAggregateStats(const std::set<std::string> &F,
     }
   }
 
-  O << "{\"AggregateStats\":[";
-  O << "{\""
-    << "TotalStats"
-    << "\":{";
-  O << "\"constraints\":" << AllAtoms.size() << ",";
-  O << "\"ptr\":" << TotP << ",";
-  O << "\"ntarr\":" << TotNt << ",";
-  O << "\"arr\":" << TotA << ",";
-  O << "\"wild\":" << TotWi;
-  O << "}},";
-  O << "{\"ArrBoundsStats\":";
-  ArrBInfo.printStats(O, ArrPtrs, true);
-  O << "},";
-  O << "{\"NtArrBoundsStats\":";
-  ArrBInfo.printStats(O, NtArrPtrs, true);
-  O << "},";
-  O << "{\"PerformanceStats\":";
-  PerfS.printPerformanceStats(O, true);
-  O << "}";
-  O << "]}";
+  llvm::json::OStream J(O);
+  J.object([&] {
+    J.attributeArray("AggregateStats", [&] {
+      J.object([&] {
+        J.attributeObject("TotalStats", [&] {
+          J.attribute("constraints", int64_t(AllAtoms.size()));
+          J.attribute("ptr", TotP);
+          J.attribute("ntarr", TotNt);
+          J.attribute("arr", TotA);
+          J.attribute("wild", TotWi);
+        });
+      });
+      J.object([&] {
+        J.attributeBegin("ArrBoundsStats");
+        ArrBInfo.printStats(J, ArrPtrs);
+        J.attributeEnd();
+      });
+      J.object([&] {
+        J.attributeBegin("NtArrBoundsStats");
+        ArrBInfo.printStats(J, NtArrPtrs);
+        J.attributeEnd();
+      });
+      J.object([&] {
+        J.attributeBegin("PerformanceStats");
+        PerfS.printPerformanceStats(J);
+        J.attributeEnd();
+      });
+    });
+  });
 }
 
 // Print out statistics of constraint variables on a per-file basis.
@@ -294,85 +314,95 @@ void ProgramInfo::printStats(const std::set<std::string> &F, raw_ostream &O,
     }
   }
 
-  // Then, dump the map to output.
-  // if not only summary then dump everything.
-  if (JsonFormat) {
-    O << "{\"Stats\":{";
-    O << "\"ConstraintStats\":{";
-  }
-  if (!OnlySummary) {
-    if (JsonFormat) {
-      O << "\"Individual\":[";
-    } else {
-      O << "file|#constraints|#ptr|#ntarr|#arr|#wild\n";
-    }
-  }
-  bool AddComma = false;
   for (const auto &I : FilesToVars) {
     int V, P, Nt, A, W;
     std::tie(V, P, Nt, A, W) = I.second;
-
     TotC += V;
     TotP += P;
     TotNt += Nt;
     TotA += A;
     TotWi += W;
-    if (!OnlySummary) {
-      if (JsonFormat) {
-        if (AddComma) {
-          O << ",\n";
-        }
-        O << "{" << llvm::json::Value(I.first) << ":{";
-        O << "\"constraints\":" << V << ",";
-        O << "\"ptr\":" << P << ",";
-        O << "\"ntarr\":" << Nt << ",";
-        O << "\"arr\":" << A << ",";
-        O << "\"wild\":" << W;
-        O << "}}";
-        AddComma = true;
-      } else {
-        O << I.first << "|" << V << "|" << P << "|" << Nt << "|" << A << "|"
-          << W;
-        O << "\n";
-      }
-    }
   }
-  if (!OnlySummary && JsonFormat) {
-    O << "],";
+
+  size_t CacheNodes = 0, CacheEvictions = 0;
+  for (const ConstraintsGraph *CG : {&CS.getChkCG(), &CS.getPtrTypCG()}) {
+    CacheNodes += CG->getBFSCacheNodes();
+    CacheEvictions += CG->getBFSCacheEvictions();
   }
+  ArrBInfo.addReachabilityCacheStats(CacheNodes, CacheEvictions);
+  PerfS.ReachabilityCacheNodes = CacheNodes;
+  PerfS.ReachabilityCacheEvictions = CacheEvictions;
 
-  if (!JsonFormat) {
-    O << "Summary\nTotalConstraints|TotalPtrs|TotalNTArr|TotalArr|TotalWild\n";
-    O << TotC << "|" << TotP << "|" << TotNt << "|" << TotA << "|" << TotWi
-      << "\n";
-  } else {
-    O << "\"Summary\":{";
-    O << "\"TotalConstraints\":" << TotC << ",";
-    O << "\"TotalPtrs\":" << TotP << ",";
-    O << "\"TotalNTArr\":" << TotNt << ",";
-    O << "\"TotalArr\":" << TotA << ",";
-    O << "\"TotalWild\":" << TotWi;
-    O << "}},\n";
+  const auto &CSBHandler = ArrBInfo.getCtxSensBoundsHandler();
+  PerfS.CtxSensContexts = CSBHandler.getNumContexts();
+  PerfS.CtxSensContextsMerged = CSBHandler.getNumMergedContexts();
+  PerfS.CtxSensContextsCapped = CSBHandler.getNumCappedContexts();
+  PerfS.CtxSensKeys = CSBHandler.getNumCtxSensKeys();
+
+  if (JsonFormat) {
+    llvm::json::OStream J(O);
+    J.object([&] {
+      J.attributeObject("Stats", [&] {
+        J.attributeObject("ConstraintStats", [&] {
+          if (!OnlySummary) {
+            J.attributeArray("Individual", [&] {
+              for (const auto &I : FilesToVars) {
+                int V, P, Nt, A, W;
+                std::tie(V, P, Nt, A, W) = I.second;
+                J.object([&] {
+                  J.attributeObject(I.first, [&] {
+                    J.attribute("constraints", V);
+                    J.attribute("ptr", P);
+                    J.attribute("ntarr", Nt);
+                    J.attribute("arr", A);
+                    J.attribute("wild", W);
+                  });
+                });
+              }
+            });
+          }
+          J.attributeObject("Summary", [&] {
+            J.attribute("TotalConstraints", TotC);
+            J.attribute("TotalPtrs", TotP);
+            J.attribute("TotalNTArr", TotNt);
+            J.attribute("TotalArr", TotA);
+            J.attribute("TotalWild", TotWi);
+          });
+        });
+        if (_3COpts.AllTypes) {
+          J.attributeBegin("BoundsStats");
+          ArrBInfo.printStats(J, InSrcCVars);
+          J.attributeEnd();
+        }
+        J.attributeBegin("PerformanceStats");
+        PerfS.printPerformanceStats(J);
+        J.attributeEnd();
+      });
+    });
+    return;
   }
 
-  if (_3COpts.AllTypes) {
-    if (JsonFormat) {
-      O << "\"BoundsStats\":";
+  // Then, dump the map to output.
+  // if not only summary then dump everything.
+  if (!OnlySummary) {
+    O << "file|#constraints|#ptr|#ntarr|#arr|#wild\n";
+    for (const auto &I : FilesToVars) {
+      int V, P, Nt, A, W;
+      std::tie(V, P, Nt, A, W) = I.second;
+      O << I.first << "|" << V << "|" << P << "|" << Nt << "|" << A << "|"
+        << W;
+      O << "\n";
     }
-    ArrBInfo.printStats(O, InSrcCVars, JsonFormat);
-    if (JsonFormat)
-      O << ",";
   }
 
-  if (JsonFormat) {
-    O << "\"PerformanceStats\":";
-  }
+  O << "Summary\nTotalConstraints|TotalPtrs|TotalNTArr|TotalArr|TotalWild\n";
+  O << TotC << "|" << TotP << "|" << TotNt << "|" << TotA << "|" << TotWi
+    << "\n";
 
-  PerfS.printPerformanceStats(O, JsonFormat);
+  if (_3COpts.AllTypes)
+    ArrBInfo.printStats(O, InSrcCVars);
 
-  if (JsonFormat) {
-    O << "}}";
-  }
+  PerfS.printPerformanceStats(O, false);
 }
 
 bool ProgramInfo::link() {
@@ -478,6 +508,8 @@ void ProgramInfo::linkFunction(FunctionVariableConstraint *FV) {
 // ReversePDMap.
 void ProgramInfo::enterCompilationUnit(ASTContext &Context) {
   assert(Persisted);
+  assert("Translation unit was not registered before it was entered." &&
+         TranslationUnitIdxMap.find(&Context) != TranslationUnitIdxMap.end());
   // Get a set of all of the PersistentSourceLoc's we need to fill in.
   std::set<PersistentSourceLoc> P;
   //for (auto I : PersistentVariables)
@@ -564,11 +596,26 @@ ProgramInfo::insertNewFVConstraint(FunctionDecl *FD, FVConstraint *NewC,
 
 // For each pointer type in the declaration of D, add a variable to the
 // constraint system for that pointer type.
+std::string ProgramInfo::getTypeString(clang::QualType QT,
+                                       llvm::StringRef Name) const {
+  if (PrecomputedTypeStrings != nullptr) {
+    auto It = PrecomputedTypeStrings->find(
+        std::make_pair(QT.getAsOpaquePtr(), Name));
+    if (It != PrecomputedTypeStrings->end())
+      return It->second;
+  }
+  return qtyToStr(QT, Name.str());
+}
+
 void ProgramInfo::addVariable(clang::DeclaratorDecl *D,
                               clang::ASTContext *AstContext) {
-  assert(!Persisted);
+  addVariable(D, AstContext, PersistentSourceLoc::mkPSL(D, *AstContext));
+}
 
-  PersistentSourceLoc PLoc = PersistentSourceLoc::mkPSL(D, *AstContext);
+void ProgramInfo::addVariable(clang::DeclaratorDecl *D,
+                              clang::ASTContext *AstContext,
+                              const PersistentSourceLoc &PLoc) {
+  assert(!Persisted);
   assert(PLoc.valid());
 
   // We only add a PVConstraint if Variables[PLoc] does not exist.
@@ -627,24 +674,22 @@ void ProgramInfo::addVariable(clang::DeclaratorDecl *D,
     auto RetTy = FD->getReturnType();
     unifyIfTypedef(RetTy, *AstContext, F->getExternalReturn(), Wild_to_Safe);
     unifyIfTypedef(RetTy, *AstContext, F->getInternalReturn(), Safe_to_Wild);
-    auto PSL = PersistentSourceLoc::mkPSL(FD,*AstContext);
-    ensureNtCorrect(RetTy, PSL, F->getExternalReturn());
-    ensureNtCorrect(RetTy, PSL, F->getInternalReturn());
+    ensureNtCorrect(RetTy, PLoc, F->getExternalReturn());
+    ensureNtCorrect(RetTy, PLoc, F->getInternalReturn());
 
     // Add mappings from the parameters PLoc to the constraint variables for
     // the parameters.
     for (unsigned I = 0; I < FD->getNumParams(); I++) {
       ParmVarDecl *PVD = FD->getParamDecl(I);
-      auto ParamPSL = PersistentSourceLoc::mkPSL(PVD,*AstContext);
+      PersistentSourceLoc PSL = PersistentSourceLoc::mkPSL(PVD, *AstContext);
       QualType ParamTy = PVD->getType();
       PVConstraint *PVInternal = F->getInternalParam(I);
       PVConstraint *PVExternal = F->getExternalParam(I);
       unifyIfTypedef(ParamTy, *AstContext, PVExternal, Wild_to_Safe);
       unifyIfTypedef(ParamTy, *AstContext, PVInternal, Safe_to_Wild);
-      ensureNtCorrect(ParamTy, ParamPSL, PVInternal);
-      ensureNtCorrect(ParamTy, ParamPSL, PVExternal);
+      ensureNtCorrect(ParamTy, PSL, PVInternal);
+      ensureNtCorrect(ParamTy, PSL, PVExternal);
       PVInternal->setValidDecl();
-      PersistentSourceLoc PSL = PersistentSourceLoc::mkPSL(PVD, *AstContext);
       // Constraint variable is stored on the parent function, so we need to
       // constrain to WILD even if we don't end up storing this in the map.
       constrainWildIfMacro(PVExternal, PVD->getLocation(),
@@ -672,8 +717,7 @@ void ProgramInfo::addVariable(clang::DeclaratorDecl *D,
       NewCV = P;
       std::string VarName(VD->getName());
       unifyIfTypedef(QT, *AstContext, P);
-      auto PSL = PersistentSourceLoc::mkPSL(VD, *AstContext);
-      ensureNtCorrect(VD->getType(), PSL, P);
+      ensureNtCorrect(VD->getType(), PLoc, P);
       if (VD->hasGlobalStorage()) {
         // If we see a definition for this global variable, indicate so in
         // ExternGVars.
@@ -793,11 +837,12 @@ void ProgramInfo::removePersistentConstraints(Expr *E, ASTContext *C) {
 
   // Save VarAtom locations so they can be used to assign source locations to
   // root causes.
+  const PersistentSourceLoc &PSL = ExprLocations[Key];
   for (auto *CV : ExprConstraintVars[Key].first)
     if (auto *PVC  = dyn_cast<PointerVariableConstraint>(CV))
       for (Atom *A : PVC->getCvars())
         if (auto *VA = dyn_cast<VarAtom>(A))
-          DeletedAtomLocations[VA->getLoc()] = ExprLocations[Key];
+          DeletedAtomLocations[VA->getLoc()] = PSL;
 
   ExprConstraintVars.erase(Key);
   ExprLocations.erase(Key);
@@ -936,7 +981,7 @@ bool ProgramInfo::computeInterimConstraintState(
 
   // Get all the valid vars of interest i.e., all the Vars that are present
   // in one of the files being compiled.
-  CAtoms ValidVarsVec;
+  std::set<Atom *> ValidVarsS;
   std::set<Atom *> AllValidVars;
   CVarSet Visited;
   CAtoms Tmp;
@@ -948,14 +993,10 @@ bool ProgramInfo::computeInterimConstraintState(
       getVarsFromConstraint(C, Tmp, Visited);
       AllValidVars.insert(Tmp.begin(), Tmp.end());
       if (canWrite(FileName))
-        ValidVarsVec.insert(ValidVarsVec.begin(), Tmp.begin(), Tmp.end());
+        ValidVarsS.insert(Tmp.begin(), Tmp.end());
     }
   }
 
-  // Make that into set, for efficiency.
-  std::set<Atom *> ValidVarsS;
-  ValidVarsS.insert(ValidVarsVec.begin(), ValidVarsVec.end());
-
   auto GetLocOrZero = [](const Atom *Val) {
     if (const auto *VA = dyn_cast<VarAtom>(Val))
       return VA->getLoc();
@@ -973,38 +1014,43 @@ bool ProgramInfo::computeInterimConstraintState(
   std::set<Atom *> DirectWildVarAtoms;
   CS.getChkCG().getSuccessors(CS.getWild(), DirectWildVarAtoms);
 
-  CVars TmpCGrp;
-  CVars OnlyIndirect;
-  for (auto *A : DirectWildVarAtoms) {
-    auto *VA = dyn_cast<VarAtom>(A);
-    if (VA == nullptr)
-      continue;
-
-    TmpCGrp.clear();
-    OnlyIndirect.clear();
-
-    auto BFSVisitor = [&](Atom *SearchAtom) {
-      auto *SearchVA = dyn_cast<VarAtom>(SearchAtom);
-      if (SearchVA && AllValidVars.find(SearchVA) != AllValidVars.end()) {
-        CState.RCMap[SearchVA->getLoc()].insert(VA->getLoc());
-
-        if (ValidVarsKey.find(SearchVA->getLoc()) != ValidVarsKey.end())
-          TmpCGrp.insert(SearchVA->getLoc());
-        if (DirectWildVarAtoms.find(SearchVA) == DirectWildVarAtoms.end()) {
-          OnlyIndirect.insert(SearchVA->getLoc());
-        }
-      }
-    };
-    CS.getChkCG().visitBreadthFirst(VA, BFSVisitor);
-
-    CState.TotalNonDirectWildAtoms.insert(OnlyIndirect.begin(),
-                                          OnlyIndirect.end());
+  // Attribute every atom to the direct WILD atoms that reach it. Roots are
+  // sorted by key so that the root indices passed to the visitor are also in
+  // key order.
+  std::vector<Atom *> Roots;
+  for (auto *A : DirectWildVarAtoms)
+    if (isa<VarAtom>(A))
+      Roots.push_back(A);
+  llvm::sort(Roots, [](const Atom *A, const Atom *B) {
+    return cast<VarAtom>(A)->getLoc() < cast<VarAtom>(B)->getLoc();
+  });
+  std::vector<ConstraintKey> RootKeys;
+  std::vector<CVars *> RootSrcW;
+  for (auto *A : Roots) {
+    ConstraintKey RootKey = cast<VarAtom>(A)->getLoc();
+    RootKeys.push_back(RootKey);
     // Should we consider only pointers which with in the source files or
     // external pointers that affected pointers within the source files.
-    CState.AllWildAtoms.insert(VA->getLoc());
-    CVars &CGrp = CState.SrcWMap[VA->getLoc()];
-    CGrp.insert(TmpCGrp.begin(), TmpCGrp.end());
+    CState.AllWildAtoms.insert(RootKey);
+    RootSrcW.push_back(&CState.SrcWMap[RootKey]);
   }
+  auto RootVisitor = [&](Atom *SearchAtom, llvm::ArrayRef<unsigned> RootIdxs) {
+    auto *SearchVA = dyn_cast<VarAtom>(SearchAtom);
+    if (SearchVA == nullptr ||
+        AllValidVars.find(SearchVA) == AllValidVars.end())
+      return;
+    ConstraintKey SearchKey = SearchVA->getLoc();
+    CVars &RootCauses = CState.RCMap[SearchKey];
+    for (unsigned R : RootIdxs)
+      RootCauses.insert(RootCauses.end(), RootKeys[R]);
+    if (ValidVarsKey.find(SearchKey) != ValidVarsKey.end())
+      for (unsigned R : RootIdxs)
+        RootSrcW[R]->insert(SearchKey);
+    if (DirectWildVarAtoms.find(SearchVA) == DirectWildVarAtoms.end())
+      CState.TotalNonDirectWildAtoms.insert(SearchKey);
+  };
+  CS.getChkCG().visitReachingRoots(Roots, RootVisitor);
+
   findIntersection(CState.AllWildAtoms, ValidVarsKey, CState.InSrcWildAtoms);
   findIntersection(CState.TotalNonDirectWildAtoms, ValidVarsKey,
                    CState.InSrcNonDirectWildAtoms);
@@ -1017,9 +1063,16 @@ bool ProgramInfo::computeInterimConstraintState(
   // overwrite a PSL already recorded for a given atom.
   for (const auto &I : Variables)
     insertIntoPtrSourceMap(I.first, I.second);
-  for (const auto &I : ExprConstraintVars) {
-    PersistentSourceLoc PSL = ExprLocations[I.first];
-    for (auto *J : I.second.first)
+  // ExprConstraintVars is hashed, so visit it in key order to keep the
+  // choice of PSL deterministic.
+  std::vector<IDAndTranslationUnit> ExprKeys;
+  ExprKeys.reserve(ExprConstraintVars.size());
+  for (const auto &I : ExprConstraintVars)
+    ExprKeys.push_back(I.first);
+  llvm::sort(ExprKeys);
+  for (const auto &Key : ExprKeys) {
+    const PersistentSourceLoc &PSL = ExprLocations[Key];
+    for (auto *J : ExprConstraintVars[Key].first)
       insertIntoPtrSourceMap(PSL, J);
   }
   for (auto E : DeletedAtomLocations)
@@ -1051,6 +1104,52 @@ bool ProgramInfo::computeInterimConstraintState(
   return true;
 }
 
+void ProgramInfo::removeWildRootsFromInterimState(
+    const std::set<VarAtom *> &FormerRoots) {
+  for (VarAtom *Root : FormerRoots) {
+    ConstraintKey RootKey = Root->getLoc();
+    if (CState.AllWildAtoms.erase(RootKey) == 0)
+      continue;
+    bool InSrc = CState.InSrcWildAtoms.erase(RootKey) != 0;
+    CState.SrcWMap.erase(RootKey);
+    CState.PtrSrcWMap.erase(RootKey);
+    CState.RootWildAtomsWithReason.erase(RootKey);
+
+    // Only the atoms reachable from the former root were attributed to it.
+    auto RemoveRoot = [&](Atom *SearchAtom) {
+      auto *SearchVA = dyn_cast<VarAtom>(SearchAtom);
+      if (SearchVA == nullptr)
+        return;
+      ConstraintKey SearchKey = SearchVA->getLoc();
+      auto RC = CState.RCMap.find(SearchKey);
+      if (RC == CState.RCMap.end() || RC->second.erase(RootKey) == 0)
+        return;
+      auto CV = CState.AtomPtrMap.find(SearchKey);
+      if (CV != CState.AtomPtrMap.end()) {
+        auto PtrRC = CState.PtrRCMap.find(CV->second);
+        if (PtrRC != CState.PtrRCMap.end()) {
+          PtrRC->second.erase(RootKey);
+          if (PtrRC->second.empty())
+            CState.PtrRCMap.erase(PtrRC);
+        }
+      }
+      if (RC->second.empty()) {
+        CState.RCMap.erase(RC);
+        CState.TotalNonDirectWildAtoms.erase(SearchKey);
+        CState.InSrcNonDirectWildAtoms.erase(SearchKey);
+      }
+    };
+    CS.getChkCG().visitBreadthFirst(Root, RemoveRoot);
+
+    // The former root is still WILD if another root reaches it.
+    if (CState.RCMap.find(RootKey) != CState.RCMap.end()) {
+      CState.TotalNonDirectWildAtoms.insert(RootKey);
+      if (InSrc)
+        CState.InSrcNonDirectWildAtoms.insert(RootKey);
+    }
+  }
+}
+
 void ProgramInfo::insertIntoPtrSourceMap(PersistentSourceLoc PSL,
                                          ConstraintVariable *CV) {
   std::string FilePath = PSL.getFileName();
@@ -1100,7 +1199,8 @@ void ProgramInfo::insertCVAtoms(
 
 void ProgramInfo::computePtrLevelStats() {
   // Construct a map from Atoms to their containing constraint variable
-  std::map<ConstraintKey, ConstraintVariable *> AtomPtrMap;
+  auto &AtomPtrMap = CState.AtomPtrMap;
+  AtomPtrMap.clear();
   for (const auto &I : Variables)
     insertCVAtoms(I.second, AtomPtrMap);
 
@@ -1126,13 +1226,13 @@ void ProgramInfo::setTypeParamBinding(CallExpr *CE, unsigned int TypeVarIdx,
                                       ASTContext *C) {
 
   auto Key = getExprKey(CE, C);
-  auto CallMap = TypeParamBindings[Key];
+  auto &CallMap = TypeParamBindings[Key];
   if (CallMap.find(TypeVarIdx) == CallMap.end()) {
-    TypeParamBindings[Key][TypeVarIdx] = TypeParamConstraint(CV,Ident);
+    CallMap[TypeVarIdx] = TypeParamConstraint(CV,Ident);
   } else {
     // If this CE/idx is at the same location, it's in a macro,
     // so mark it as inconsistent.
-    TypeParamBindings[Key][TypeVarIdx] = TypeParamConstraint(nullptr,nullptr);
+    CallMap[TypeVarIdx] = TypeParamConstraint(nullptr,nullptr);
   }
 }
 
@@ -1177,12 +1277,13 @@ void ProgramInfo::addTypedef(PersistentSourceLoc PSL, bool CanRewriteDef,
   this->TypedefVars[PSL] = {*V};
 }
 
-void ProgramInfo::registerTranslationUnits(
-    const std::vector<std::unique_ptr<clang::ASTUnit>> &ASTs) {
-  assert(TranslationUnitIdxMap.empty());
-  unsigned int Idx = 0;
-  for (const auto &AST : ASTs) {
-    TranslationUnitIdxMap[&(AST->getASTContext())] = Idx;
-    Idx++;
-  }
+void ProgramInfo::registerTranslationUnit(ASTContext *C, unsigned int Idx) {
+  assert(TranslationUnitIdxMap.find(C) == TranslationUnitIdxMap.end());
+  TranslationUnitIdxMap[C] = Idx;
+  PersistentSourceLoc::cacheFileNames(*C);
+}
+
+void ProgramInfo::unregisterTranslationUnit(ASTContext *C) {
+  assert(Persisted && "Cannot unload a translation unit that is in use.");
+  TranslationUnitIdxMap.erase(C);
 }
@@ -12,48 +12,33 @@
 
 #include "clang/3C/ProgramVar.h"
 
-GlobalScope *GlobalScope::ProgScope = nullptr;
-std::set<StructScope, PVSComp> StructScope::AllStScopes;
-std::set<CtxStructScope, PVSComp> CtxStructScope::AllCtxStScopes;
-std::set<FunctionParamScope, PVSComp> FunctionParamScope::AllFnParamScopes;
-std::set<FunctionScope, PVSComp> FunctionScope::AllFnScopes;
-std::set<CtxFunctionArgScope, PVSComp> CtxFunctionArgScope::AllCtxFnArgScopes;
-
 GlobalScope *GlobalScope::getGlobalScope() {
-  if (ProgScope == nullptr) {
-    ProgScope = new GlobalScope();
-  }
-  return ProgScope;
+  static GlobalScope ProgScope;
+  return &ProgScope;
 }
 
-const StructScope *StructScope::getStructScope(std::string StName) {
-  StructScope TmpS(StName);
-  if (AllStScopes.find(TmpS) == AllStScopes.end()) {
-    AllStScopes.insert(TmpS);
-  }
-  const auto &SS = *AllStScopes.find(TmpS);
-  return &SS;
+const StructScope *
+ProgramVarScopeTable::getStructScope(llvm::StringRef StName) {
+  return &StScopes.try_emplace(StName, StName.str()).first->second;
 }
 
-const CtxStructScope *CtxStructScope::getCtxStructScope(const StructScope *SS,
-                                                        std::string AS,
-                                                        bool IsGlobal) {
-  CtxStructScope TmpCSS(SS->getSName(), AS, IsGlobal);
-  if (AllCtxStScopes.find(TmpCSS) == AllCtxStScopes.end()) {
-    AllCtxStScopes.insert(TmpCSS);
-  }
-  const auto &CSS = *AllCtxStScopes.find(TmpCSS);
-  return &CSS;
+const CtxStructScope *
+ProgramVarScopeTable::getCtxStructScope(const StructScope *SS,
+                                        llvm::StringRef AS, bool IsGlobal) {
+  std::string SName = SS->getSName();
+  // Struct names cannot contain ':', so this key is unambiguous.
+  std::string Key = SName + ":" + AS.str();
+  return &CtxStScopes[IsGlobal]
+              .try_emplace(Key, SName, AS.str(), IsGlobal)
+              .first->second;
 }
 
 const FunctionParamScope *
-FunctionParamScope::getFunctionParamScope(std::string FnName, bool IsSt) {
-  FunctionParamScope TmpFPS(FnName, IsSt);
-  if (AllFnParamScopes.find(TmpFPS) == AllFnParamScopes.end()) {
-    AllFnParamScopes.insert(TmpFPS);
-  }
-  const auto &FPS = *AllFnParamScopes.find(TmpFPS);
-  return &FPS;
+ProgramVarScopeTable::getFunctionParamScope(llvm::StringRef FnName,
+                                            bool IsSt) {
+  return &FnParamScopes[IsSt]
+              .try_emplace(FnName, FnName.str(), IsSt)
+              .first->second;
 }
 
 bool FunctionScope::isInInnerScope(const ProgramVarScope &O) const {
@@ -72,30 +57,20 @@ bool FunctionScope::isInInnerScope(const ProgramVarScope &O) const {
   return false;
 }
 
-const CtxFunctionArgScope *
-CtxFunctionArgScope::getCtxFunctionParamScope(const FunctionParamScope *FPS,
-                                              const PersistentSourceLoc &PSL) {
-  CtxFunctionArgScope TmpAS(std::string(FPS->getFName()), FPS->getIsStatic(),
-                            PSL);
-  if (AllCtxFnArgScopes.find(TmpAS) == AllCtxFnArgScopes.end()) {
-    AllCtxFnArgScopes.insert(TmpAS);
-  }
-  const auto &CFAS = *AllCtxFnArgScopes.find(TmpAS);
-  return &CFAS;
+const CtxFunctionArgScope *ProgramVarScopeTable::getCtxFunctionParamScope(
+    const FunctionParamScope *FPS, const PersistentSourceLoc &PSL) {
+  auto &CFAS = CtxFnArgScopes[{FPS, PSL}];
+  if (!CFAS)
+    CFAS = std::make_unique<CtxFunctionArgScope>(
+        std::string(FPS->getFName()), FPS->getIsStatic(), PSL);
+  return CFAS.get();
 }
 
-const FunctionScope *FunctionScope::getFunctionScope(std::string FnName,
-                                                     bool IsSt) {
-  FunctionScope TmpFS(FnName, IsSt);
-  if (AllFnScopes.find(TmpFS) == AllFnScopes.end()) {
-    AllFnScopes.insert(TmpFS);
-  }
-  const auto &FS = *AllFnScopes.find(TmpFS);
-  return &FS;
+const FunctionScope *ProgramVarScopeTable::getFunctionScope(
+    llvm::StringRef FnName, bool IsSt) {
+  return &FnScopes[IsSt].try_emplace(FnName, FnName.str(), IsSt).first->second;
 }
 
-std::set<const ProgramVar *> ProgramVar::AllProgramVars;
-
 std::string ProgramVar::verboseStr() const {
   std::string Ret = std::to_string(K) + "_";
   if (IsConstant)
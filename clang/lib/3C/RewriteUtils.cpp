@@ -17,6 +17,7 @@
 #include "clang/3C/TypeVariableAnalysis.h"
 #include "clang/AST/RecursiveASTVisitor.h"
 #include "clang/Tooling/Transformer/SourceCode.h"
+#include "llvm/Support/TimeProfiler.h"
 
 using namespace llvm;
 using namespace clang;
@@ -116,11 +117,15 @@ void rewriteSourceRange(Rewriter &R, const CharSourceRange &Range,
   }
 }
 
-static void emit(Rewriter &R, ASTContext &C, bool &StdoutModeEmittedMainFile) {
+static void emit(Rewriter &R, ASTContext &C, bool &StdoutModeEmittedMainFile,
+                 std::map<std::string, RewrittenFile> &ChangedFiles) {
   if (_3COpts.Verbose)
     errs() << "Writing files out\n";
 
-  bool StdoutMode = (_3COpts.OutputPostfix == "-" && _3COpts.OutputDir.empty());
+  // The 3C server uses stdout for its responses, so without an output
+  // location it keys the new versions by the paths of the files they replace.
+  bool StdoutMode = (_3COpts.OutputPostfix == "-" &&
+                     _3COpts.OutputDir.empty() && !_3COpts.Server);
   SourceManager &SM = C.getSourceManager();
   // Iterate over each modified rewrite buffer.
   for (auto Buffer = R.buffer_begin(); Buffer != R.buffer_end(); ++Buffer) {
@@ -237,9 +242,10 @@ static void emit(Rewriter &R, ASTContext &C, bool &StdoutModeEmittedMainFile) {
       // Produce a path/file name for the rewritten source file.
       std::string NFile;
       // We now know that we are using either OutputPostfix or OutputDir mode
-      // because stdout mode is handled above. OutputPostfix defaults to "-"
-      // when it's not provided, so any other value means that we should use
-      // OutputPostfix. Otherwise, we must be in OutputDir mode.
+      // (or the server mode without either) because stdout mode is handled
+      // above. OutputPostfix defaults to "-" when it's not provided, so any
+      // other value means that we should use OutputPostfix. Otherwise, we must
+      // be in OutputDir mode if OutputDir is set.
       if (_3COpts.OutputPostfix != "-") {
         // That path should be the same as the old one, with a
         // suffix added between the file name and the extension.
@@ -253,8 +259,7 @@ static void emit(Rewriter &R, ASTContext &C, bool &StdoutModeEmittedMainFile) {
         NFile = Stem + "." + _3COpts.OutputPostfix + Ext;
         if (!DirName.empty())
           NFile = DirName + sys::path::get_separator().str() + NFile;
-      } else {
-        assert(!_3COpts.OutputDir.empty());
+      } else if (!_3COpts.OutputDir.empty()) {
         // If this does not hold when OutputDir is set, it should have been a
         // fatal error in the _3CInterface constructor.
         assert(filePathStartsWith(FeAbsS, _3COpts.BaseDir));
@@ -274,23 +279,22 @@ static void emit(Rewriter &R, ASTContext &C, bool &StdoutModeEmittedMainFile) {
               << NFile;
           continue;
         }
-      }
-
-      raw_fd_ostream Out(NFile, EC, sys::fs::F_None);
-
-      if (!EC) {
-        if (_3COpts.Verbose)
-          errs() << "writing out " << NFile << "\n";
-        Buffer->second.write(Out);
       } else {
-        reportCustomDiagnostic(DE, DiagnosticsEngine::Error,
-                               "failed to write output file \"%0\"",
-                               BeginningOfFileSourceLoc)
-            << NFile;
-        // This is awkward. What to do? Since we're iterating, we could have
-        // created other files successfully. Do we go back and erase them? Is
-        // that surprising? For now, let's just keep going.
+        assert(_3COpts.Server);
+        NFile = FeAbsS;
       }
+
+      // Other translation units that include this file will produce their own
+      // version of it, so the file is not written until all translation units
+      // that include it have been rewritten (see
+      // RewriteConsumer::writeFinishedFiles). As when each translation unit
+      // wrote the file directly, the last version wins.
+      RewrittenFile &NewVersion = ChangedFiles[NFile];
+      NewVersion.SourceFile = FeAbsS;
+      NewVersion.NewContents.clear();
+      raw_string_ostream Out(NewVersion.NewContents);
+      Buffer->second.write(Out);
+      Out.flush();
     }
   }
 
@@ -623,9 +627,49 @@ void RewriteConsumer::emitRootCauseDiagnostics(ASTContext &Context) {
   }
 }
 
+void RewriteConsumer::writeFile(const std::string &NFile,
+                                const RewrittenFile &File,
+                                ASTContext &Context) {
+  std::error_code EC;
+  raw_fd_ostream Out(NFile, EC, sys::fs::F_None);
+  if (EC) {
+    SourceManager &SM = Context.getSourceManager();
+    SourceLocation BeginningOfFileSourceLoc;
+    if (auto FE = SM.getFileManager().getFile(File.SourceFile))
+      BeginningOfFileSourceLoc = SM.translateFileLineCol(*FE, 1, 1);
+    reportCustomDiagnostic(Context.getDiagnostics(), DiagnosticsEngine::Error,
+                           "failed to write output file \"%0\"",
+                           BeginningOfFileSourceLoc)
+        << NFile;
+    // This is awkward. What to do? Since we're iterating, we could have
+    // created other files successfully. Do we go back and erase them? Is
+    // that surprising? For now, let's just keep going.
+    return;
+  }
+  if (_3COpts.Verbose)
+    errs() << "writing out " << NFile << "\n";
+  Out << File.NewContents;
+}
+
+void RewriteConsumer::writeFinishedFiles(
+    ASTContext &Context, llvm::function_ref<bool(StringRef)> IsFinished) {
+  for (auto I = ChangedFiles.begin(); I != ChangedFiles.end();) {
+    if (!IsFinished(I->second.SourceFile)) {
+      ++I;
+      continue;
+    }
+    writeFile(I->first, I->second, Context);
+    I = ChangedFiles.erase(I);
+  }
+}
+
 void RewriteConsumer::HandleTranslationUnit(ASTContext &Context) {
   Info.enterCompilationUnit(Context);
 
+  llvm::TimeTraceScope TraceScope("3C rewriter", [&Context] {
+    return PerformanceStats::getTUName(Context);
+  });
+  WallClockTimer TUTimer;
   Info.getPerfStats().startRewritingTime();
 
   if (_3COpts.WarnRootCause)
@@ -636,8 +680,8 @@ void RewriteConsumer::HandleTranslationUnit(ASTContext &Context) {
   DeclRewriter::rewriteDecls(Context, Info, R);
 
   // Take care of some other rewriting tasks
-  std::set<llvm::FoldingSetNodeID> Seen;
-  std::map<llvm::FoldingSetNodeID, AnnotationNeeded> NodeMap;
+  llvm::DenseSet<const Stmt *> Seen;
+  llvm::DenseMap<const Stmt *, AnnotationNeeded> NodeMap;
   CheckedRegionFinder CRF(&Context, R, Info, Seen, NodeMap,
                           _3COpts.WarnRootCause);
   CheckedRegionAdder CRA(&Context, R, NodeMap, Info);
@@ -666,9 +710,10 @@ void RewriteConsumer::HandleTranslationUnit(ASTContext &Context) {
   }
 
   // Output files.
-  emit(R, Context, StdoutModeEmittedMainFile);
+  emit(R, Context, StdoutModeEmittedMainFile, ChangedFiles);
 
   Info.getPerfStats().endRewritingTime();
+  Info.getPerfStats().getTUTimes(Context).RewritingTime += TUTimer.seconds();
 
   Info.exitCompilationUnit();
   return;
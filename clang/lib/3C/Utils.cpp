@@ -14,7 +14,9 @@
 #include "clang/AST/FormatString.h"
 #include "clang/Sema/Sema.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/StringSaver.h"
 #include <errno.h>
+#include <mutex>
 
 using namespace llvm;
 using namespace clang;
@@ -194,6 +196,15 @@ float getTimeSpentInSeconds(clock_t StartTime) {
   return float(clock() - StartTime) / CLOCKS_PER_SEC;
 }
 
+void writeNDJsonLine(llvm::raw_ostream &O,
+                     llvm::function_ref<void(llvm::json::OStream &)> Fn) {
+  {
+    llvm::json::OStream J(O);
+    Fn(J);
+  }
+  O << "\n";
+}
+
 bool isPointerType(clang::ValueDecl *VD) {
   return VD->getType().getTypePtr()->isPointerType();
 }
@@ -234,6 +245,16 @@ std::string tyToStr(const clang::Type *T, const std::string &Name) {
   return qtyToStr(QualType(T, 0), Name);
 }
 
+llvm::StringRef internString(llvm::StringRef S) {
+  if (S.empty())
+    return llvm::StringRef();
+  static llvm::BumpPtrAllocator Alloc;
+  static llvm::UniqueStringSaver Pool(Alloc);
+  static std::mutex PoolMutex;
+  std::lock_guard<std::mutex> Lock(PoolMutex);
+  return Pool.save(S);
+}
+
 Expr *removeAuxillaryCasts(Expr *E) {
   bool NeedStrip = true;
   while (NeedStrip) {
@@ -0,0 +1,44 @@
+// RUN: rm -rf %t*
+// RUN: mkdir %t && cd %t
+// RUN: 3c -base-dir=%S -alltypes -dump-stats %s -- > %t.c 2> %t.stderr
+// RUN: FileCheck -match-full-lines --input-file %t.c %s
+// RUN: FileCheck -check-prefix=CHECK_STATS --input-file %t.stderr %s
+// RUN: 3c -base-dir=%S -alltypes -dump-stats -no-incremental-bounds %s -- > %t.full.c 2> %t.full.stderr
+// RUN: diff %t.c %t.full.c
+// RUN: python -c "import re, sys; v = lambda f: int(re.search(r'KeysVisited:(\d+)', open(f).read()).group(1)); sys.exit(not v(sys.argv[1]) < v(sys.argv[2]))" %t.stderr %t.full.stderr
+
+/*
+Array bounds inference that takes several rounds: the bounds of arr come from
+potential bounds, then flow to arr1 through the call and on to arr2. After the
+first round, a round only visits the keys reachable from the keys whose bounds
+changed, so b is not visited again and the last rounds are skipped. The output
+is the same as when every round visits every key (-no-incremental-bounds).
+*/
+
+int foo(int *arr, unsigned len) {
+  unsigned i = 0;
+  for (i = 0; i < len; i++) {
+    arr[i] = 0;
+  }
+  return 0;
+}
+
+//CHECK: int foo(_Array_ptr<int> arr : count(len), unsigned len) {
+
+void baz() {
+  unsigned n;
+  int *arr1;
+  foo(arr1, n);
+  int *arr2 = arr1;
+  arr2[0] = 1;
+}
+
+//CHECK: _Array_ptr<int> arr1 : count(n) = ((void *)0);
+//CHECK: _Array_ptr<int> arr2 : count(n) = arr1;
+
+void bar(int *b) { b[2] = 0; }
+
+//CHECK: void bar(_Array_ptr<int> b) { b[2] = 0; }
+
+//CHECK_STATS: ArrayBoundsInferenceStats
+//CHECK_STATS: RoundsSkipped:{{[1-9][0-9]*}}
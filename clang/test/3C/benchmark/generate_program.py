@@ -0,0 +1,235 @@
+#!/usr/bin/env python3
+"""Generate C programs of controllable size for benchmarking 3c.
+
+The programs are not meant to do anything useful. They exercise the parts of
+3c whose cost grows with program size:
+
+- pointer density: the number of pointer locals in each function, which form
+  chains of assignments;
+- call-graph depth: functions are grouped into call chains of a given length,
+  and consecutive functions of a chain may live in different translation
+  units, so that linking has work to do;
+- cycles of pointer flow: rings of globals assigned to one another and rings
+  of functions that pass a pointer around;
+- struct nesting: every function takes a pointer to a struct nested to a given
+  depth, and reads and writes pointers through it;
+- array and malloc patterns: malloc'd buffers indexed in loops (so array
+  bounds inference has something to infer) and stack arrays;
+- unsafe casts, which make a fraction of the pointers WILD.
+
+The output is deterministic for a given set of parameters and seed.
+
+Usage:
+    generate_program.py --output-dir DIR [--files N] [--functions N] ...
+
+The program consists of DIR/common.h and DIR/tu_0.c ... DIR/tu_<N-1>.c.
+"""
+
+import argparse
+import os
+import random
+
+# Parameters and their defaults. run_benchmark.py uses the same names.
+DEFAULTS = {
+    'files': 1,
+    'functions': 20,
+    'pointer_density': 4,
+    'call_depth': 4,
+    'cycles': 1,
+    'cycle_length': 4,
+    'struct_depth': 2,
+    'arrays': 1,
+    'wild_ratio': 0.1,
+    'seed': 0,
+}
+
+
+def struct_defs(depth):
+    lines = []
+    for level in range(depth):
+        lines.append('struct node%d {' % level)
+        if level == 0:
+            lines.append('  int *data;')
+            lines.append('  int len;')
+            lines.append('  struct node0 *next;')
+        else:
+            lines.append('  struct node%d inner;' % (level - 1))
+            lines.append('  struct node%d *child;' % (level - 1))
+            lines.append('  int *data;')
+        lines.append('};')
+        lines.append('')
+    return lines
+
+
+def innermost_data(depth):
+    """The expression for the data field of the innermost struct of s."""
+    if depth == 1:
+        return 's->data'
+    return 's->inner' + '.inner' * (depth - 2) + '.data'
+
+
+class Program:
+
+    def __init__(self, params):
+        self.p = dict(DEFAULTS)
+        self.p.update(params)
+        self.rng = random.Random(self.p['seed'])
+        self.top = 'struct node%d' % (self.p['struct_depth'] - 1)
+        self.num_funcs = self.p['files'] * self.p['functions']
+        # Spread the statements of each pointer-flow cycle over the functions.
+        self.cycle_stmts = {}
+        for k in range(self.p['cycles']):
+            length = self.p['cycle_length']
+            for j in range(length):
+                g = self.rng.randrange(self.num_funcs)
+                self.cycle_stmts.setdefault(g, []).append(
+                    'cyc_%d_%d = cyc_%d_%d;' % (k, j, k, (j + 1) % length))
+            g = self.rng.randrange(self.num_funcs)
+            self.cycle_stmts.setdefault(g, []).append(
+                'l0 = ring_%d_0(l0, n);' % k)
+
+    def file_of(self, g):
+        return g // self.p['functions']
+
+    def func_proto(self, g):
+        return 'int *f_%d(int *p0, %s *s, int n)' % (g, self.top)
+
+    def ring_proto(self, k, j):
+        return 'int *ring_%d_%d(int *p, int n)' % (k, j)
+
+    def header(self):
+        lines = ['#include <stdlib.h>', '']
+        lines += struct_defs(self.p['struct_depth'])
+        for k in range(self.p['cycles']):
+            for j in range(self.p['cycle_length']):
+                lines.append('extern int *cyc_%d_%d;' % (k, j))
+                lines.append(self.ring_proto(k, j) + ';')
+        lines.append('')
+        for g in range(self.num_funcs):
+            lines.append(self.func_proto(g) + ';')
+        return lines
+
+    def func_body(self, g):
+        p = self.p
+        density = max(p['pointer_density'], 2)
+        lines = [self.func_proto(g) + ' {']
+        lines.append('  int *l0 = p0;')
+        lines.append('  int *l1 = s->data;')
+        for i in range(2, density):
+            lines.append('  int *l%d = l%d;' % (i, self.rng.randrange(i)))
+
+        for a in range(p['arrays']):
+            lines.append('  int *a%d = malloc(n * sizeof(int));' % a)
+            lines.append('  for (int i = 0; i < n; i++)')
+            lines.append('    a%d[i] = i;' % a)
+            lines.append('  int b%d[8];' % a)
+            lines.append('  b%d[n %% 8] = a%d[0];' % (a, a))
+            lines.append('  l%d = a%d;' % (self.rng.randrange(density), a))
+
+        if p['struct_depth'] > 1:
+            lines.append('  %s = l%d;' % (innermost_data(p['struct_depth']),
+                                          density - 1))
+            lines.append('  s->child->data = l1;')
+        else:
+            lines.append('  s->next->data = l%d;' % (density - 1))
+
+        for stmt in self.cycle_stmts.get(g, []):
+            lines.append('  ' + stmt)
+
+        if self.rng.random() < p['wild_ratio']:
+            lines.append('  l1 = (int *)(char *)l0;')
+
+        depth = max(p['call_depth'], 1)
+        if g % depth != depth - 1 and g + 1 < self.num_funcs:
+            lines.append('  if (n > 0)')
+            lines.append('    l0 = f_%d(l1, s, n - 1);' % (g + 1))
+        lines.append('  return l0;')
+        lines.append('}')
+        return lines
+
+    def ring_body(self, k, j):
+        nxt = (j + 1) % self.p['cycle_length']
+        return [
+            self.ring_proto(k, j) + ' {',
+            '  if (n <= 0)',
+            '    return p;',
+            '  return ring_%d_%d(p, n - 1);' % (k, nxt),
+            '}',
+        ]
+
+    def translation_unit(self, f):
+        lines = ['#include "common.h"', '']
+        if f == 0:
+            for k in range(self.p['cycles']):
+                for j in range(self.p['cycle_length']):
+                    lines.append('int *cyc_%d_%d;' % (k, j))
+            lines.append('')
+        for k in range(self.p['cycles']):
+            for j in range(self.p['cycle_length']):
+                if (k * self.p['cycle_length'] + j) % self.p['files'] == f:
+                    lines += self.ring_body(k, j)
+                    lines.append('')
+        for g in range(self.num_funcs):
+            if self.file_of(g) == f:
+                lines += self.func_body(g)
+                lines.append('')
+        return lines
+
+
+def generate(params, out_dir):
+    """Write the program to out_dir and return the paths of its .c files."""
+    prog = Program(params)
+    os.makedirs(out_dir, exist_ok=True)
+
+    def write(name, lines):
+        path = os.path.join(out_dir, name)
+        with open(path, 'w') as f:
+            f.write('\n'.join(lines) + '\n')
+        return path
+
+    write('common.h', prog.header())
+    return [
+        write('tu_%d.c' % f, prog.translation_unit(f))
+        for f in range(prog.p['files'])
+    ]
+
+
+def add_arguments(parser):
+    parser.add_argument('--files', type=int, default=DEFAULTS['files'],
+                        help='number of translation units')
+    parser.add_argument('--functions', type=int,
+                        default=DEFAULTS['functions'],
+                        help='functions per translation unit')
+    parser.add_argument('--pointer-density', type=int,
+                        default=DEFAULTS['pointer_density'],
+                        help='pointer locals per function')
+    parser.add_argument('--call-depth', type=int,
+                        default=DEFAULTS['call_depth'],
+                        help='length of the call chains')
+    parser.add_argument('--cycles', type=int, default=DEFAULTS['cycles'],
+                        help='number of pointer-flow cycles')
+    parser.add_argument('--cycle-length', type=int,
+                        default=DEFAULTS['cycle_length'],
+                        help='globals and functions in each cycle')
+    parser.add_argument('--struct-depth', type=int,
+                        default=DEFAULTS['struct_depth'],
+                        help='nesting depth of the struct passed around')
+    parser.add_argument('--arrays', type=int, default=DEFAULTS['arrays'],
+                        help='malloc and stack array patterns per function')
+    parser.add_argument('--wild-ratio', type=float,
+                        default=DEFAULTS['wild_ratio'],
+                        help='fraction of functions with an unsafe cast')
+    parser.add_argument('--seed', type=int, default=DEFAULTS['seed'])
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    add_arguments(parser)
+    parser.add_argument('--output-dir', required=True)
+    args = parser.parse_args()
+    params = {k: getattr(args, k) for k in DEFAULTS}
+    generate(params, args.output_dir)
+
+
+if __name__ == '__main__':
+    main()
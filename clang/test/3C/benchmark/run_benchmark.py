@@ -0,0 +1,208 @@
+#!/usr/bin/env python3
+"""Run 3c on generated programs and record the time and memory of each phase.
+
+For each benchmark configuration, this generates a program with
+generate_program.py, runs the whole 3c pipeline on it with -dump-stats, and
+collects the PhaseStats section of the -stats-output JSON (wall-clock time,
+CPU time, net malloc bytes and peak RSS of each phase), along with the array
+bounds inference counters and the constraint totals. The results of all
+configurations are written to one JSON file:
+
+    {"Format": 1,
+     "Benchmarks": [{"Name": ..., "Parameters": {...}, "Lines": ...,
+                     "Phases": {"ConstraintSolver": {"WallTime": ...}, ...},
+                     "ArrayBoundsInferenceStats": {...},
+                     "Summary": {...}}, ...]}
+
+With --baseline, the phase wall-clock times are compared with those of an
+earlier results file, and the script exits with status 1 if any phase of any
+benchmark became slower by more than --threshold.
+
+Usage:
+    run_benchmark.py --3c PATH/TO/3c --work-dir DIR --output RESULTS.json
+                     [--sizes small,medium] [--repetitions N]
+                     [--baseline OLD.json [--threshold 0.1]]
+"""
+
+import argparse
+import json
+import os
+import shutil
+import subprocess
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import generate_program
+
+FORMAT_VERSION = 1
+
+# Benchmark configurations, from quick to slow. Parameters not given here take
+# the defaults of generate_program.py.
+SIZES = {
+    'small': {
+        'files': 2,
+        'functions': 50,
+    },
+    'medium': {
+        'files': 8,
+        'functions': 200,
+        'pointer_density': 6,
+        'call_depth': 8,
+        'cycles': 8,
+        'struct_depth': 3,
+        'arrays': 2,
+    },
+    'large': {
+        'files': 32,
+        'functions': 500,
+        'pointer_density': 8,
+        'call_depth': 16,
+        'cycles': 32,
+        'cycle_length': 8,
+        'struct_depth': 4,
+        'arrays': 2,
+    },
+    # Stresses the solver with long cycles of pointer flow.
+    'cycles': {
+        'files': 4,
+        'functions': 100,
+        'cycles': 64,
+        'cycle_length': 32,
+    },
+    # Stresses array bounds inference.
+    'arrays': {
+        'files': 4,
+        'functions': 100,
+        'arrays': 8,
+        'wild_ratio': 0.0,
+    },
+}
+
+
+def die(msg):
+    sys.stderr.write('Error: %s\n' % msg)
+    sys.exit(1)
+
+
+def run_3c(threec, work_dir, sources, extra_args):
+    stats = os.path.join(work_dir, 'stats.json')
+    cmd = [
+        threec, '-alltypes', '-dump-stats',
+        '-base-dir=' + work_dir,
+        '-output-dir=' + os.path.join(work_dir, 'out'),
+        '-stats-output=' + stats,
+        '-wildptrstats-output=' + os.path.join(work_dir, 'wild.json'),
+        '-perptrstats-output=' + os.path.join(work_dir, 'perwild.json'),
+    ] + extra_args + sources + ['--']
+    result = subprocess.run(cmd, cwd=work_dir, stdout=subprocess.DEVNULL,
+                            stderr=subprocess.PIPE, universal_newlines=True)
+    if result.returncode != 0:
+        die('3c failed on %s:\n%s' % (work_dir, result.stderr))
+    with open(stats) as f:
+        return json.load(f)['Stats']
+
+
+def run_benchmark(name, params, args):
+    work_dir = os.path.join(os.path.abspath(args.work_dir), name)
+    shutil.rmtree(work_dir, ignore_errors=True)
+    sources = generate_program.generate(params, work_dir)
+    lines = 0
+    for path in sources + [os.path.join(work_dir, 'common.h')]:
+        with open(path) as f:
+            lines += sum(1 for _ in f)
+
+    # Keep the fastest run of each phase; peak memory does not depend on
+    # scheduling noise, so any run will do.
+    phases = {}
+    for _ in range(args.repetitions):
+        shutil.rmtree(os.path.join(work_dir, 'out'), ignore_errors=True)
+        stats = run_3c(args.threec, work_dir, sources, args.extra_arg)
+        perf = {}
+        for section in stats['PerformanceStats']:
+            perf.update(section)
+        for phase, values in perf['PhaseStats'].items():
+            best = phases.get(phase)
+            if best is None or values['WallTime'] < best['WallTime']:
+                phases[phase] = values
+
+    return {
+        'Name': name,
+        'Parameters': dict(generate_program.DEFAULTS, **params),
+        'Lines': lines,
+        'Phases': phases,
+        'ArrayBoundsInferenceStats': perf['ArrayBoundsInferenceStats'],
+        'Summary': stats['ConstraintStats']['Summary'],
+    }
+
+
+def compare(results, baseline, threshold):
+    """Print the phases that got slower and return whether there were any."""
+    old = {b['Name']: b for b in baseline['Benchmarks']}
+    regressed = False
+    for bench in results['Benchmarks']:
+        base = old.get(bench['Name'])
+        if base is None:
+            continue
+        if base['Parameters'] != bench['Parameters']:
+            print('%s: parameters differ from the baseline; not compared' %
+                  bench['Name'])
+            continue
+        for phase, values in sorted(bench['Phases'].items()):
+            before = base['Phases'].get(phase, {}).get('WallTime')
+            after = values['WallTime']
+            if not before:
+                continue
+            change = (after - before) / before
+            marker = ''
+            if change > threshold:
+                marker = '  <-- regression'
+                regressed = True
+            print('%-8s %-22s %9.3fs -> %9.3fs  %+6.1f%%%s' %
+                  (bench['Name'], phase, before, after, change * 100, marker))
+    return regressed
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('--3c', dest='threec', default='3c',
+                        help='the 3c binary to benchmark')
+    parser.add_argument('--work-dir', required=True,
+                        help='directory for the generated programs')
+    parser.add_argument('--output', required=True,
+                        help='file to which the results are written')
+    parser.add_argument('--sizes', default='small,medium',
+                        help='comma-separated configurations to run, from: ' +
+                        ', '.join(SIZES))
+    parser.add_argument('--repetitions', type=int, default=1,
+                        help='runs of each configuration; the fastest counts')
+    parser.add_argument('--extra-arg', action='append', default=[],
+                        help='additional argument for 3c (repeatable)')
+    parser.add_argument('--baseline',
+                        help='results file of an earlier run to compare with')
+    parser.add_argument('--threshold', type=float, default=0.1,
+                        help='relative slowdown reported as a regression')
+    args = parser.parse_args()
+
+    names = [n for n in args.sizes.split(',') if n]
+    for name in names:
+        if name not in SIZES:
+            die('unknown configuration "%s"' % name)
+
+    results = {'Format': FORMAT_VERSION, 'Benchmarks': []}
+    for name in names:
+        results['Benchmarks'].append(run_benchmark(name, SIZES[name], args))
+    with open(args.output, 'w') as f:
+        json.dump(results, f, indent=2, sort_keys=True)
+        f.write('\n')
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        if baseline.get('Format') != FORMAT_VERSION:
+            die('the baseline has a different format version')
+        if compare(results, baseline, args.threshold):
+            sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,12 @@
+// Checks that the programs of the benchmark generator (see
+// benchmark/generate_program.py) go through 3c, and that the benchmark driver
+// can read the statistics that 3c writes.
+
+// RUN: rm -rf %t && mkdir %t
+// RUN: python %S/benchmark/generate_program.py --files 2 --functions 6 --call-depth 3 --cycles 1 --struct-depth 2 --seed 1 --output-dir %t/gen
+// RUN: cd %t/gen && 3c -alltypes -base-dir=%t/gen -output-dir=%t/gen/out %t/gen/tu_0.c %t/gen/tu_1.c --
+// RUN: test -f %t/gen/out/tu_0.c && test -f %t/gen/out/tu_1.c
+// RUN: python %S/benchmark/run_benchmark.py --3c 3c --sizes small --work-dir %t/bench --output %t/results.json
+// RUN: python -c "import json; b = json.load(open('%t/results.json'))['Benchmarks'][0]; assert b['Name'] == 'small' and b['Phases']['ConstraintSolver']['WallTime'] >= 0"
+// RUN: python %S/benchmark/run_benchmark.py --3c 3c --sizes small --work-dir %t/bench --output %t/results2.json --baseline %t/results.json --threshold 1000 | FileCheck %s
+// CHECK: small {{ *}}ConstraintSolver
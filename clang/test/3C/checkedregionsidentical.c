@@ -0,0 +1,14 @@
+// RUN: 3c -base-dir=%S -addcr %s -- | FileCheck -match-full-lines %s
+// RUN: 3c -base-dir=%S -addcr %s -- | %clang -c -fcheckedc-extension -x c -o /dev/null -
+
+/* Statements with identical structure are still annotated independently. */
+
+int safe(void) {
+  //CHECK: int safe(void) _Checked {
+  return 0;
+}
+
+int unsafe(int a, ...) {
+  //CHECK: int unsafe(int a, ...) {
+  return 0;
+}
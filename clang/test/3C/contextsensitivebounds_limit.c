@@ -0,0 +1,35 @@
+// Tests the summarization of the contexts of context-sensitive bounds keys:
+// calls with the same callee and arguments share a context, and a callee gets
+// at most -max-ctx-per-callee contexts. Neither changes the inferred bounds
+// here, so the output is the same as without a limit.
+
+// RUN: rm -rf %t*
+// RUN: mkdir %t && cd %t
+// RUN: 3c -base-dir=%S -alltypes -dump-stats -max-ctx-per-callee=2 %s -- 2>stderr | FileCheck -match-full-lines %s
+// RUN: FileCheck -match-full-lines -check-prefixes="CHECK_STDERR" --input-file %t/stderr %s
+// RUN: 3c -base-dir=%S -alltypes %s -- | FileCheck -match-full-lines %s
+// RUN: 3c -base-dir=%S -alltypes -max-ctx-per-callee=2 %s -- | %clang -c -fcheckedc-extension -x c -o /dev/null -
+
+void fill(int *buf, unsigned len) {
+  for (unsigned i = 0; i < len; i++)
+    buf[i] = 0;
+}
+//CHECK: void fill(_Array_ptr<int> buf : count(len), unsigned len) {
+
+void use(int *p, int *q, int *r, unsigned n, unsigned m) {
+  // A new context.
+  fill(p, n);
+  // Same callee and arguments as the previous call; shares its context.
+  fill(p, n);
+  // A second context.
+  fill(q, m);
+  // Over the limit; uses the context-insensitive keys.
+  fill(r, 3);
+}
+//CHECK: void use(_Array_ptr<int> p : count(n), _Array_ptr<int> q : count(m), _Array_ptr<int> r : count(3), unsigned n, unsigned m) {
+
+//CHECK_STDERR: ContextSensitiveBoundsStats
+//CHECK_STDERR-NEXT: Contexts:2
+//CHECK_STDERR-NEXT: MergedContexts:1
+//CHECK_STDERR-NEXT: CappedContexts:1
+//CHECK_STDERR-NEXT: Keys:{{[0-9]+}}
@@ -2,6 +2,13 @@
 //RUN: 3c -base-dir=%S -output-dir=%t.checked %s %S/extGVarbar2.c --
 //RUN: FileCheck -match-full-lines --input-file %t.checked/extGVarbar1.c %s
 //RUN: %clang -working-directory=%t.checked -c extGVarbar1.c extGVarbar2.c
+//RUN: 3c -base-dir=%S -output-dir=%t.bounded -max-resident-asts=1 %s %S/extGVarbar2.c --
+//RUN: FileCheck -match-full-lines --input-file %t.bounded/extGVarbar1.c %s
+//RUN: mkdir -p %t.unwritable/extGVarbar1.c
+//RUN: not 3c -base-dir=%S -output-dir=%t.unwritable -max-resident-asts=1 %s %S/extGVarbar2.c -- 2>&1 | FileCheck -check-prefix=UNWRITABLE %s
+//UNWRITABLE: {{.*}}extGVarbar1.c:1:1: error: failed to write output file "{{.*}}extGVarbar1.c"
+//RUN: 3c -base-dir=%S -output-dir=%t.parallel -num-threads=2 %s %S/extGVarbar2.c --
+//RUN: FileCheck -match-full-lines --input-file %t.parallel/extGVarbar1.c %s
 
 // This test cannot use pipes because it requires multiple output files
 
@@ -5,6 +5,9 @@
 // RUN: mkdir %t.noalltypes && cd %t.noalltypes
 // RUN: 3c -base-dir=%S -dump-stats -dump-intermediate -debug-solver %s --
 // RUN: python -c "import json, glob; [json.load(open(f)) for f in glob.glob('*.json')]"
+// RUN: mkdir %t.ndjson && cd %t.ndjson
+// RUN: 3c -base-dir=%S -dump-intermediate -constraint-output-ndjson %s --
+// RUN: python -c "import json, glob; fs = glob.glob('*.ndjson'); assert fs; [json.loads(l) for f in fs for l in open(f)]"
 
 // Testing that json files output for statistics logging are well formed
 
@@ -0,0 +1,59 @@
+// Tests the 3C server (-server): the initial conversion, a conversion after an
+// edit that re-parses only the edited translation unit, the queries, removing
+// root causes, recovering from a failed conversion, and error responses.
+// The requests are the SEND lines below (see server_session.py).
+
+// RUN: rm -rf %t && mkdir %t && cd %t
+// RUN: printf 'int *g(int *x) { return x; }\n' > a.c
+// RUN: printf 'int *g(int *x);\nvoid f(void) { int *q = g(0); }\n' > b.c
+// RUN: printf 'int *g(int *x);\nvoid f(void) { int *q = g((int *)(char *)0); int *r = (int *)(char *)0; }\n' > b_edited.c
+// RUN: printf 'void f(void) { int *q = }\n' > b_broken.c
+// RUN: printf 'void f(void) {}\n' > b_plain.c
+// RUN: python %S/server_session.py %s -- 3c -server -verbose -base-dir=%t a.c b.c -- 2>stderr | FileCheck -match-full-lines %s
+// RUN: FileCheck -check-prefix=CHECK_STDERR --input-file stderr %s
+
+// SEND: {"jsonrpc": "2.0", "id": 1, "method": "initialize"}
+// CHECK: {"id":1,"jsonrpc":"2.0","result":{"rewrites":[{"contents":"_Ptr<int> g(_Ptr<int> x) { return x; }\n","file":"{{.*}}/a.c",{{.*}}"file":"{{.*}}/b.c",{{.*}}],"wildRoots":[]}}
+
+// The unsafe cast makes the parameter of g WILD in both files.
+// COPY: b_edited.c b.c
+// SEND: {"jsonrpc": "2.0", "id": 2, "method": "fileChanged", "params": {"files": ["b.c"]}}
+// CHECK: {"id":2,"jsonrpc":"2.0","result":{"rewrites":[{{.*}}"file":"{{.*}}/a.c",{{.*}}],"wildRoots":[{{.*}}"file":"{{.*}}/b.c",{{.*}}]}}
+// CHECK_STDERR: Re-parsing 1 of 2 translation units
+
+// A notification gets no response.
+// SEND: {"jsonrpc": "2.0", "method": "getRewrites"}
+// SEND: {"jsonrpc": "2.0", "id": 3, "method": "bogus"}
+// CHECK: {"error":{"code":-32601,"message":"unknown method \"bogus\""},"id":3,"jsonrpc":"2.0"}
+// SEND: {"jsonrpc": "2.0", "id": 4, "method": "fileChanged"}
+// CHECK: {"error":{"code":-32602,"message":"missing \"files\" parameter"},"id":4,"jsonrpc":"2.0"}
+
+// SEND: {"jsonrpc": "2.0", "id": 5, "method": "getRewrites", "params": {"files": ["a.c"]}}
+// CHECK: {"id":5,"jsonrpc":"2.0","result":[{"contents":"{{.*}}","file":"{{.*}}/a.c","output":"{{.*}}/a.c"}]}
+// SEND: {"jsonrpc": "2.0", "id": 6, "method": "getWildRoots", "params": {"files": ["b.c"]}}
+// CHECK: {"id":6,"jsonrpc":"2.0","result":[{{.*}}"file":"{{.*}}/b.c",{{.*}}"reason":"Cast from char * to int *"},{{.*}}"file":"{{.*}}/b.c",{{.*}}"reason":"Cast from char * to int *"}]}
+
+// Removing one of the two casts' root causes leaves the other.
+// SEND: {"jsonrpc": "2.0", "id": 7, "method": "makeNonWild", "params": {"key": "$root:Cast"}}
+// CHECK: {"id":7,"jsonrpc":"2.0","result":{"rewrites":[{{.*}}],"wildRoots":[{{.*}}"reason":"Cast from char * to int *"}]}}
+// Removing it globally removes both.
+// SEND: {"jsonrpc": "2.0", "id": 8, "method": "makeNonWild", "params": {"key": "$root:Cast", "global": true}}
+// CHECK: {"id":8,"jsonrpc":"2.0","result":{"rewrites":[{{.*}}"contents":"{{.*}}_Ptr<int> q = {{.*}}_Ptr<int> r = {{.*}}","file":"{{.*}}/b.c",{{.*}}],"wildRoots":[]}}
+// SEND: {"jsonrpc": "2.0", "id": 9, "method": "makeNonWild", "params": {"key": 0}}
+// CHECK: {"error":{"code":-32602,"message":"atom 0 is not directly WILD"},"id":9,"jsonrpc":"2.0"}
+
+// After a failed conversion, only an edit can bring the server back.
+// COPY: b_broken.c b.c
+// SEND: {"jsonrpc": "2.0", "id": 10, "method": "fileChanged", "params": {"files": ["b.c"]}}
+// CHECK: {"error":{"code":-32603,"message":"failed to convert the program; see stderr"},"id":10,"jsonrpc":"2.0"}
+// SEND: {"jsonrpc": "2.0", "id": 11, "method": "getRewrites"}
+// CHECK: {"error":{"code":-32603,"message":"the last conversion failed; edit the program to convert it again"},"id":11,"jsonrpc":"2.0"}
+
+// b.c no longer needs any change, so its rewrite is withdrawn. a.c is the
+// same as last reported, so it is not listed.
+// COPY: b_plain.c b.c
+// SEND: {"jsonrpc": "2.0", "id": 12, "method": "fileChanged", "params": {"files": ["b.c"]}}
+// CHECK: {"id":12,"jsonrpc":"2.0","result":{"rewrites":[{"contents":null,"file":"{{.*}}/b.c","output":"{{.*}}/b.c"}],"wildRoots":[]}}
+
+// SEND: {"jsonrpc": "2.0", "id": 13, "method": "shutdown"}
+// CHECK: {"id":13,"jsonrpc":"2.0","result":null}
@@ -0,0 +1,46 @@
+// Tests the makeNonWild request of the 3C server (-server). Removing the WILD
+// constraint of an ordinary root updates the solution incrementally; removing
+// the one 3C added for conflicting pointer types solves the constraints again,
+// and the conflict comes back. The same session run with -no-incremental-solve,
+// which always solves from scratch, must give the same responses.
+// The requests are the SEND lines below (see server_session.py).
+
+// RUN: rm -rf %t && mkdir %t && cd %t
+// RUN: printf 'int *id(int *x) { return x; }\nvoid single(void) { int *p = id((int *)(char *)0); }\nvoid global(void) { int *a = (int *)(float *)0; int *b = (int *)(float *)0; }\n' > a.c
+// RUN: printf 'int get_strlen(char *s : itype(_Nt_array_ptr<char>));\nvoid conflict(void) { char *c; get_strlen(c); char **cptr = &c; }\n' > c.c
+// RUN: python %S/server_session.py %s -- 3c -server -verbose -alltypes -base-dir=%t a.c c.c -- > out 2>stderr
+// RUN: FileCheck -match-full-lines --input-file out %s
+// RUN: FileCheck -check-prefix=CHECK_STDERR --input-file stderr %s
+// RUN: python %S/server_session.py %s -- 3c -server -verbose -alltypes -no-incremental-solve -base-dir=%t a.c c.c -- > out_full 2>stderr_full
+// RUN: not grep incrementally stderr_full
+// RUN: diff out out_full
+
+// SEND: {"jsonrpc": "2.0", "id": 1, "method": "initialize"}
+// CHECK: {"id":1,"jsonrpc":"2.0","result":{"rewrites":[{{.*}}],"wildRoots":[{{.*}}"reason":"Cast from char * to int *"{{.*}}"reason":"Cast from float * to int *"{{.*}}"reason":"Inferred conflicting types"{{.*}}]}}
+
+// Only the cast to char * made id WILD. The roots of the other casts in a.c
+// are still there.
+// SEND: {"jsonrpc": "2.0", "id": 2, "method": "makeNonWild", "params": {"key": "$root:char *"}}
+// CHECK: {"id":2,"jsonrpc":"2.0","result":{"rewrites":[{"contents":"_Ptr<int> id(_Ptr<int> x) { return x; }\n{{.*}}","file":"{{.*}}/a.c",{{.*}}}],"wildRoots":[{{\{[^}]*"reason":"Cast from float \* to int \*"\},\{[^}]*"reason":"Cast from float \* to int \*"\}\]}}}}
+// CHECK_STDERR: Updated the solution incrementally
+
+// Both casts to float * have the same reason, so both roots go away.
+// SEND: {"jsonrpc": "2.0", "id": 3, "method": "makeNonWild", "params": {"key": "$root:float *", "global": true}}
+// CHECK: {"id":3,"jsonrpc":"2.0","result":{"rewrites":[{"contents":"{{.*}}_Ptr<int> a = {{.*}}_Ptr<int> b = {{.*}}","file":"{{.*}}/a.c",{{.*}}}],"wildRoots":[]}}
+// CHECK_STDERR: Updated the solution incrementally
+
+// SEND: {"jsonrpc": "2.0", "id": 4, "method": "getWildRoots", "params": {"files": ["a.c"]}}
+// CHECK: {"id":4,"jsonrpc":"2.0","result":[]}
+// SEND: {"jsonrpc": "2.0", "id": 5, "method": "getWildRoots"}
+// CHECK: {"id":5,"jsonrpc":"2.0","result":[{{.*}}"reason":"Inferred conflicting types"{{.*}}]}
+
+// c is still used both as a _Ptr and as an _Nt_array_ptr, so solving the
+// constraints again makes it WILD again and nothing changes.
+// SEND: {"jsonrpc": "2.0", "id": 6, "method": "makeNonWild", "params": {"key": "$root:conflicting"}}
+// CHECK: {"id":6,"jsonrpc":"2.0","result":{"rewrites":[],"wildRoots":[]}}
+// CHECK_STDERR: Solved the constraints again
+// SEND: {"jsonrpc": "2.0", "id": 7, "method": "getWildRoots"}
+// CHECK: {"id":7,"jsonrpc":"2.0","result":[{{.*}}"reason":"Inferred conflicting types"{{.*}}]}
+
+// SEND: {"jsonrpc": "2.0", "id": 8, "method": "shutdown"}
+// CHECK: {"id":8,"jsonrpc":"2.0","result":null}
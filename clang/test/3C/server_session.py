@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+"""Drive a `3c -server` session for the lit tests.
+
+Usage:
+    server_session.py SESSION -- 3c -server ARGS...
+
+Runs the given command and plays the session described by the SESSION file,
+which is normally the test file itself. Lines of the form
+
+    // SEND: {"jsonrpc": "2.0", "id": 1, "method": ...}
+    // COPY: SRC DST
+
+send a request to the server, or copy a file once the server has answered all
+the requests sent so far, so that edits happen between requests. Other lines
+are ignored. The responses are printed one per line as compact JSON with sorted
+keys, and the script exits with the status of the server.
+
+Atom keys are not stable across changes to 3C, so a request can name a WILD
+root by its reason instead: a string "$root:TEXT" in a request is replaced by
+the key of the first root whose reason contains TEXT in the last response that
+listed roots. Such a request is sent once the earlier ones are answered.
+"""
+
+import json
+import shutil
+import subprocess
+import sys
+
+
+def main():
+    session = sys.argv[1]
+    assert sys.argv[2] == '--'
+    server = subprocess.Popen(sys.argv[3:], stdin=subprocess.PIPE,
+                              stdout=subprocess.PIPE, universal_newlines=True)
+    pending = 0
+    roots = []
+
+    def read_responses():
+        nonlocal pending, roots
+        while pending:
+            line = server.stdout.readline()
+            if not line:
+                sys.exit('error: the server exited before answering')
+            response = json.loads(line)
+            print(json.dumps(response, sort_keys=True, separators=(',', ':')))
+            pending -= 1
+            result = response.get('result')
+            if isinstance(result, dict) and 'wildRoots' in result:
+                roots = result['wildRoots']
+            elif isinstance(result, list) and result and all(
+                    'key' in r for r in result):
+                roots = result
+
+    def substitute_roots(value):
+        if isinstance(value, dict):
+            return {k: substitute_roots(v) for k, v in value.items()}
+        if isinstance(value, list):
+            return [substitute_roots(v) for v in value]
+        if isinstance(value, str) and value.startswith('$root:'):
+            text = value[len('$root:'):]
+            for root in roots:
+                if text in root['reason']:
+                    return root['key']
+            sys.exit('error: no WILD root with reason "%s"' % text)
+        return value
+
+    with open(session) as f:
+        for line in f:
+            line = line.strip()
+            if line.startswith('// SEND: '):
+                request = json.loads(line[len('// SEND: '):])
+                if '"$root:' in line:
+                    read_responses()
+                    request = substitute_roots(request)
+                server.stdin.write(json.dumps(request) + '\n')
+                server.stdin.flush()
+                if 'id' in request:
+                    pending += 1
+            elif line.startswith('// COPY: '):
+                read_responses()
+                src, dst = line[len('// COPY: '):].split()
+                shutil.copyfile(src, dst)
+    read_responses()
+    server.stdin.close()
+    sys.exit(server.wait())
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,38 @@
+// Tests that solving the independent components of the constraint graph on
+// several threads gives the same result as solving them on one.
+
+// RUN: rm -rf %t*
+// RUN: 3c -base-dir=%S -alltypes -num-threads=1 %s -- > %t.serial.c
+// RUN: FileCheck -match-full-lines --input-file %t.serial.c %s
+// RUN: 3c -base-dir=%S -alltypes -num-threads=4 -min-atoms-parallel-solve=0 %s -- > %t.parallel.c
+// RUN: diff %t.serial.c %t.parallel.c
+
+#include <stdlib.h>
+
+int *id(int *p) { return p; }
+//CHECK: _Ptr<int> id(_Ptr<int> p) { return p; }
+
+void wild(int *p) { p = (int *)1; }
+//CHECK: void wild(int *p) { p = (int *)1; }
+
+int *arr(int n) {
+  int *a = malloc(n * sizeof(int));
+  for (int i = 0; i < n; i++)
+    a[i] = i;
+  return a;
+}
+//CHECK:   _Array_ptr<int> a{{.*}} = malloc<int>(n * sizeof(int));
+
+struct node {
+  struct node *next;
+  int *val;
+};
+//CHECK:   _Ptr<struct node> next;
+//CHECK:   int *val;
+
+void set(struct node *n, int *v) {
+  n->next = n;
+  n->val = v;
+  n->val = (int *)5;
+}
+//CHECK: void set(_Ptr<struct node> n, int *v) {
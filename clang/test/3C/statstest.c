@@ -2,6 +2,9 @@
 // RUN: mkdir %t && cd %t
 // RUN: 3c -dump-stats -base-dir=%S -alltypes -addcr %s -- 2>stderr | FileCheck -match-full-lines %s
 // RUN: FileCheck -match-full-lines -check-prefixes="CHECK_STDERR" --input-file %t/stderr %s
+// RUN: 3c -base-dir=%S -time-trace-file=%t/trace.json %s -- > /dev/null
+// RUN: FileCheck -check-prefixes="CHECK_TRACE" --input-file %t/trace.json %s
+// CHECK_TRACE: "name":"3C parse"
 
 
 #include <stdlib.h>
@@ -59,10 +62,19 @@ void j() {
 //CHECK_STDERR: Declared:1
 //CHECK_STDERR: TimeStats
 //CHECK_STDERR: TotalTime:{{.*}}
+//CHECK_STDERR: CompileTime:{{.*}}
+//CHECK_STDERR: VariableAdderTime:{{.*}}
 //CHECK_STDERR: ConstraintBuilderTime:{{.*}}
 //CHECK_STDERR: ConstraintSolverTime:{{.*}}
 //CHECK_STDERR: ArrayBoundsInferenceTime:{{.*}}
 //CHECK_STDERR: RewritingTime:{{.*}}
+//CHECK_STDERR: PhaseStats
+//CHECK_STDERR: Total:WallTime={{.*}},CPUTime={{.*}},MallocBytes={{-?[0-9]+}},PeakRSS={{[0-9]+}},Intervals=1
+//CHECK_STDERR: Compile:WallTime={{.*}},Intervals=1
+//CHECK_STDERR: ConstraintBuilder:WallTime={{.*}},Intervals=1
+//CHECK_STDERR: Rewriting:WallTime={{.*}},Intervals=1
+//CHECK_STDERR: TranslationUnitStats
+//CHECK_STDERR: {{.*}}statstest.c:VariableAdderTime={{.*}},ConstraintBuilderTime={{.*}},RewritingTime={{.*}}
 //CHECK_STDERR: ReWriteStats
 //CHECK_STDERR: NumAssumeBoundsCasts:1
 //CHECK_STDERR: NumCheckedCasts:0
@@ -71,3 +83,17 @@ void j() {
 //CHECK_STDERR: NumITypes:2
 //CHECK_STDERR: NumCheckedRegions:4
 //CHECK_STDERR: NumUnCheckedRegions:0
+//CHECK_STDERR: ReachabilityCacheStats
+//CHECK_STDERR: CachedNodes:{{[0-9]+}}
+//CHECK_STDERR: Evictions:0
+//CHECK_STDERR: ArrayBoundsInferenceStats
+//CHECK_STDERR: Runs:{{[0-9]+}}
+//CHECK_STDERR: Rounds:{{[0-9]+}}
+//CHECK_STDERR: RoundsSkipped:{{[0-9]+}}
+//CHECK_STDERR: KeysVisited:{{[0-9]+}}
+//CHECK_STDERR: KeysInferred:{{[0-9]+}}
+//CHECK_STDERR: ContextSensitiveBoundsStats
+//CHECK_STDERR: Contexts:{{[0-9]+}}
+//CHECK_STDERR: MergedContexts:{{[0-9]+}}
+//CHECK_STDERR: CappedContexts:{{[0-9]+}}
+//CHECK_STDERR: Keys:{{[0-9]+}}
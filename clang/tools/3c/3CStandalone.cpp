@@ -12,6 +12,7 @@
 
 #include "clang/3C/3C.h"
 #include "clang/3C/3CGlobalOptions.h"
+#include "clang/3C/3CServer.h"
 #include "clang/Tooling/CommonOptionsParser.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetSelect.h"
@@ -111,6 +112,13 @@ static cl::opt<std::string>
                             cl::init("constraint_output.json"),
                             cl::cat(_3CCategory));
 
+static cl::opt<bool> OptConstraintOutputNDJson(
+    "constraint-output-ndjson",
+    cl::desc("Write the constraint output of -dump-intermediate as "
+             "newline-delimited JSON, one record per line, so that it can be "
+             "read incrementally"),
+    cl::init(false), cl::cat(_3CCategory));
+
 static cl::opt<std::string>
     OptStatsOutputJson("stats-output",
                        cl::desc("Path to the file where all the stats "
@@ -254,6 +262,46 @@ static cl::opt<bool> OptInferTypesForUndef(
            "available documentation)."),
   cl::init(false), cl::cat(_3CCategory));
 
+static cl::opt<unsigned> OptMaxResidentASTs(
+    "max-resident-asts",
+    cl::desc("Keep at most this many translation unit ASTs in memory at once, "
+             "re-parsing a translation unit when a later stage needs an AST "
+             "that was evicted. This trades running time for lower peak memory "
+             "use on large projects. 0 (the default) keeps all ASTs in "
+             "memory."),
+    cl::init(0), cl::cat(_3CCategory));
+
+static cl::opt<unsigned> OptMaxCtxPerCallee(
+    "max-ctx-per-callee",
+    cl::desc("With -alltypes, create context-sensitive bounds keys for at most "
+             "this many call sites of each function (and access paths of each "
+             "struct). Calls beyond the limit use the context-insensitive "
+             "bounds keys. 0 (the default) means no limit."),
+    cl::init(0), cl::cat(_3CCategory));
+
+static cl::opt<unsigned> OptNumThreads(
+    "num-threads",
+    cl::desc("Number of threads to use for the phases of 3c that process "
+             "translation units in parallel. 0 uses one thread per hardware "
+             "thread. The output does not depend on this setting."),
+    cl::init(1), cl::cat(_3CCategory));
+
+static cl::opt<std::string> OptTimeTraceFile(
+    "time-trace-file",
+    cl::desc("Write a trace of the phases of 3c and of each translation unit "
+             "they process to this file, in the Chrome trace format used by "
+             "clang's -ftime-trace."),
+    cl::init(""), cl::cat(_3CCategory));
+
+static cl::opt<bool> OptServer(
+    "server",
+    cl::desc("Run as a server that keeps the program in memory and converts it "
+             "again after each edit, reading JSON-RPC requests from stdin and "
+             "writing the responses to stdout. Only the edited translation "
+             "units are re-parsed; the constraints of the whole program are "
+             "generated and solved again after every edit."),
+    cl::init(false), cl::cat(_3CCategory));
+
 #ifdef FIVE_C
 static cl::opt<bool> OptRemoveItypes(
     "remove-itypes",
@@ -308,6 +356,7 @@ int main(int argc, const char **argv) {
   CcOptions.Verbose = OptVerbose;
   CcOptions.DumpIntermediate = OptDumpIntermediate;
   CcOptions.ConstraintOutputJson = OptConstraintOutputJson.getValue();
+  CcOptions.ConstraintOutputNDJson = OptConstraintOutputNDJson;
   CcOptions.StatsOutputJson = OptStatsOutputJson.getValue();
   CcOptions.WildPtrInfoJson = OptWildPtrInfoJson.getValue();
   CcOptions.PerWildPtrInfoJson = OptPerPtrWILDInfoJson.getValue();
@@ -321,6 +370,11 @@ int main(int argc, const char **argv) {
   CcOptions.AllowRewriteFailures = OptAllowRewriteFailures;
   CcOptions.ItypesForExtern = OptItypesForExtern;
   CcOptions.InferTypesForUndefs = OptInferTypesForUndef;
+  CcOptions.MaxResidentASTs = OptMaxResidentASTs;
+  CcOptions.MaxCtxPerCallee = OptMaxCtxPerCallee;
+  CcOptions.NumThreads = OptNumThreads;
+  CcOptions.TimeTraceFile = OptTimeTraceFile;
+  CcOptions.Server = OptServer;
 
 #ifdef FIVE_C
   CcOptions.RemoveItypes = OptRemoveItypes;
@@ -343,6 +397,10 @@ int main(int argc, const char **argv) {
   } else
     CcOptions.AllocatorFunctions = {};
 
+  if (OptServer)
+    return run3CServer(CcOptions, OptionsParser.getSourcePathList(),
+                       &(OptionsParser.getCompilations()), stdin, outs());
+
   // Create 3C Interface.
   //
   // See clang/docs/checkedc/3C/clang-tidy.md#_3c-name-prefix